@@ -11,18 +11,63 @@
 #include <QLabel>
 #include <QMenuBar>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 #include <QStatusBar>
+#include <QTimer>
+#include <QFont>
 
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "Renderer.hpp"
 #include "Label.hpp"
+#include "SceneLoader.hpp"
+#include "Trace.hpp"
 
 #include "loadObj.hpp"
 
 #include <QDebug>
 
 namespace photon_mapping {
+    namespace {
+        QString phaseStatisticsText(QString const& name, RendererBase::PhaseStatistics const& phase) {
+            qint64 minWorkerNsecs = phase.nsecs;
+            qint64 barrierWaitNsecs = 0;
+            for (auto const& worker : phase.workers) {
+                minWorkerNsecs = min(minWorkerNsecs, worker.nsecs);
+                barrierWaitNsecs += worker.barrierWaitNsecs;
+            }
+            QString text = QString("%1: %2 ms, workers %3..%4 ms, barrier wait %5 ms\n")
+                .arg(name)
+                .arg(phase.nsecs / 1e6, 0, 'f', 1)
+                .arg(minWorkerNsecs / 1e6, 0, 'f', 1)
+                .arg(phase.nsecs / 1e6, 0, 'f', 1)
+                .arg(barrierWaitNsecs / 1e6, 0, 'f', 1);
+#ifdef PHOTON_MAPPING_COUNTERS
+            text += QString("  rays %1, BIH nodes %2, triangles %3\n")
+                .arg(phase.counters.raysTraced)
+                .arg(phase.counters.bihNodesVisited)
+                .arg(phase.counters.trianglesTested)
+                + QString("  gathers %1, heap ops %2\n")
+                .arg(phase.counters.photonGathers)
+                .arg(phase.counters.photonHeapOperations)
+                + QString("  irradiance cache hits %1, misses %2\n")
+                .arg(phase.counters.irradianceCacheHits)
+                .arg(phase.counters.irradianceCacheMisses);
+#endif
+            return text;
+        }
+
+        QString statisticsText(RendererBase::Statistics const& statistics) {
+            QString text;
+            text += phaseStatisticsText("Scatter", statistics.scatter);
+            text += phaseStatisticsText("Map build", statistics.mapBuild);
+            for (auto const& render : statistics.render) {
+                text += phaseStatisticsText(QString("Quality %1").arg(render.first), render.second);
+            }
+            return text;
+        }
+    }
+
     Application::Application(int& argc, char** argv)
         : QApplication(argc, argv)
     {
@@ -50,11 +95,21 @@ namespace photon_mapping {
         renderer->setCamera(camera);
         renderer->setSurface(surface);
         renderer->start();
+
+        auto sceneLoader = std::make_shared<SceneLoader>();
+        connect(sceneLoader.get(), &SceneLoader::progressed, [=]{
+            renderer->abort();
+            if (sceneLoader->commit(*scene)) {
+                renderer->invalidateScene();
+            }
+            renderer->start();
+        });
+        connect(this, &QCoreApplication::aboutToQuit, [=]{
+            sceneLoader->abort();
+        });
         
-        //FrequencyMeter* frameFrequencyMeter = new FrequencyMeter(this);
-        //frameFrequencyMeter->setSampleCount(10);
-        //frameFrequencyMeter->setFrequency((1.0 / 60.0) * 1000);
-        //connect(frameUpdater, &QTimer::timeout, frameFrequencyMeter, &FrequencyMeter::operator());
+        QTimer* statisticsUpdater = new QTimer(this);
+        statisticsUpdater->start(250);
 
         QMainWindow* mainWindow = new QMainWindow();
         mainWindow->setMenuBar([&]{
@@ -69,8 +124,8 @@ namespace photon_mapping {
                         QString objFilePath = QFileDialog::getOpenFileName(mainWindow, "Open .OBJ file", "models/", "OBJ File (*.obj)");
                         if (!objFilePath.isNull()) {
                             renderer->abort();
+                            sceneLoader->load(objFilePath);
                             scene->clear();
-                            loadObj(scene, objFilePath);
                             renderer->invalidateScene();
                             renderer->start();
                         }
@@ -85,8 +140,8 @@ namespace photon_mapping {
             Label* viewLabel = new Label(mainWindow);
             viewLabel->setFocusPolicy(Qt::StrongFocus);
             viewLabel->setFocus(Qt::ActiveWindowFocusReason);
-            connect(surface.get(), &Surface::imageUpdated, [=](QImage const& image) {
-                viewLabel->setPixmap(QPixmap::fromImage(image));
+            connect(surface.get(), &Surface::imageUpdated, [=](QImage const& image, QRect const& dirtyRect) {
+                viewLabel->updateFramebuffer(image, dirtyRect);
             });
             connect(viewLabel, &Label::keyPressed, [=](Qt::Key key){
                 float cameraVelocity = 0.1f;
@@ -169,6 +224,22 @@ namespace photon_mapping {
                 }
             });
             connect(viewLabel, &Label::mouseMoved, [=](Point2i const& position, Vector2i const& displacement) mutable {
+                if (!viewLabel->isMouseButtonPressed(Qt::LeftButton) && !viewLabel->isMouseButtonPressed(Qt::RightButton)) {
+                    static int const priorityRegionRadius = 2 * Renderer::TILE_SIZE;
+                    Point2i priorityRegionCenter = Point2i(
+                        position.x / Renderer::TILE_SIZE * Renderer::TILE_SIZE,
+                        (surface->extent().y - 1 - position.y) / Renderer::TILE_SIZE * Renderer::TILE_SIZE
+                    );
+                    Segment2i priorityRegion = Segment2i(
+                        Point2i(priorityRegionCenter.x - priorityRegionRadius, priorityRegionCenter.y - priorityRegionRadius),
+                        Point2i(priorityRegionCenter.x + priorityRegionRadius, priorityRegionCenter.y + priorityRegionRadius)
+                    );
+                    if (!renderer->hasPriorityRegion() || renderer->priorityRegion().min.x != priorityRegion.min.x || renderer->priorityRegion().min.y != priorityRegion.min.y) {
+                        renderer->abort();
+                        renderer->setPriorityRegion(priorityRegion);
+                        renderer->start();
+                    }
+                }
                 if (!viewLabel->isMouseButtonPressed(Qt::LeftButton) && viewLabel->isMouseButtonPressed(Qt::RightButton)) {
                     static float const cameraAngularVelocity = degToRad(0.2f);
                     renderer->abort();
@@ -201,6 +272,11 @@ namespace photon_mapping {
                     renderer->start();
                 }
             });
+            connect(viewLabel, &Label::mouseLeft, [=] {
+                renderer->abort();
+                renderer->clearPriorityRegion();
+                renderer->start();
+            });
             connect(viewLabel, &Label::mouseButtonReleased, [=](Qt::MouseButton mousebutton) {
                 if (mousebutton == Qt::RightButton) {
                     restoreOverrideCursor();
@@ -243,6 +319,84 @@ namespace photon_mapping {
                     });
                     return photonGatherCountSpinBox;
                 }());
+                renderSettingsFormLayout->addRow("Caustic photon count", [&]{
+                    QSpinBox* causticPhotonCountSpinBox = new QSpinBox();
+                    causticPhotonCountSpinBox->setRange(0, 1000000);
+                    causticPhotonCountSpinBox->setValue(renderer->causticPhotonCount());
+                    connect(causticPhotonCountSpinBox, &QSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setCausticPhotonCount(causticPhotonCountSpinBox->value());
+                        renderer->invalidateScene();
+                        renderer->start();
+                    });
+                    return causticPhotonCountSpinBox;
+                }());
+                renderSettingsFormLayout->addRow("Caustic photon gather count", [&]{
+                    QSpinBox* causticPhotonGatherCountSpinBox = new QSpinBox();
+                    causticPhotonGatherCountSpinBox->setRange(1, 10000);
+                    causticPhotonGatherCountSpinBox->setValue(renderer->causticPhotonGatherCount());
+                    connect(causticPhotonGatherCountSpinBox, &QSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setCausticPhotonGatherCount(causticPhotonGatherCountSpinBox->value());
+                        renderer->invalidateCamera();
+                        renderer->start();
+                    });
+                    return causticPhotonGatherCountSpinBox;
+                }());
+                renderSettingsFormLayout->addRow("Caustic gather radius", [&]{
+                    QDoubleSpinBox* causticPhotonGatherRadiusSpinBox = new QDoubleSpinBox();
+                    causticPhotonGatherRadiusSpinBox->setRange(0.001, 10.0);
+                    causticPhotonGatherRadiusSpinBox->setSingleStep(0.01);
+                    causticPhotonGatherRadiusSpinBox->setDecimals(3);
+                    causticPhotonGatherRadiusSpinBox->setValue(renderer->causticPhotonGatherRadius());
+                    connect(causticPhotonGatherRadiusSpinBox, &QDoubleSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setCausticPhotonGatherRadius(causticPhotonGatherRadiusSpinBox->value());
+                        renderer->invalidateCamera();
+                        renderer->start();
+                    });
+                    return causticPhotonGatherRadiusSpinBox;
+                }());
+                renderSettingsFormLayout->addRow("Final gather rays", [&]{
+                    QSpinBox* finalGatherRayCountSpinBox = new QSpinBox();
+                    finalGatherRayCountSpinBox->setRange(0, 4096);
+                    finalGatherRayCountSpinBox->setValue(renderer->finalGatherRayCount());
+                    connect(finalGatherRayCountSpinBox, &QSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setFinalGatherRayCount(finalGatherRayCountSpinBox->value());
+                        renderer->invalidateCamera();
+                        renderer->start();
+                    });
+                    return finalGatherRayCountSpinBox;
+                }());
+                renderSettingsFormLayout->addRow("Irradiance cache error", [&]{
+                    QDoubleSpinBox* irradianceCacheMaxErrorSpinBox = new QDoubleSpinBox();
+                    irradianceCacheMaxErrorSpinBox->setRange(0.01, 1.0);
+                    irradianceCacheMaxErrorSpinBox->setSingleStep(0.05);
+                    irradianceCacheMaxErrorSpinBox->setValue(renderer->irradianceCacheMaxError());
+                    connect(irradianceCacheMaxErrorSpinBox, &QDoubleSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setIrradianceCacheMaxError(irradianceCacheMaxErrorSpinBox->value());
+                        renderer->invalidateCamera();
+                        renderer->start();
+                    });
+                    return irradianceCacheMaxErrorSpinBox;
+                }());
+                renderSettingsFormLayout->addRow("Adaptive threshold", [&]{
+                    QDoubleSpinBox* adaptiveThresholdSpinBox = new QDoubleSpinBox();
+                    adaptiveThresholdSpinBox->setRange(0.0, 1.0);
+                    adaptiveThresholdSpinBox->setSingleStep(0.01);
+                    adaptiveThresholdSpinBox->setDecimals(3);
+                    adaptiveThresholdSpinBox->setSpecialValueText("Off");
+                    adaptiveThresholdSpinBox->setValue(renderer->adaptiveThreshold());
+                    connect(adaptiveThresholdSpinBox, &QDoubleSpinBox::editingFinished, [=]{
+                        renderer->abort();
+                        renderer->setAdaptiveThreshold(adaptiveThresholdSpinBox->value());
+                        renderer->invalidateCamera();
+                        renderer->start();
+                    });
+                    return adaptiveThresholdSpinBox;
+                }());
                 renderSettingsFormLayout->addRow([&]{
                     QPushButton* repaintPushButton = new QPushButton();
                     repaintPushButton->setText("Repaint");
@@ -253,6 +407,16 @@ namespace photon_mapping {
                     });
                     return repaintPushButton;
                 }());
+                renderSettingsFormLayout->addRow([&]{
+                    QLabel* statisticsLabel = new QLabel();
+                    QFont statisticsFont("Courier");
+                    statisticsFont.setStyleHint(QFont::Monospace);
+                    statisticsLabel->setFont(statisticsFont);
+                    connect(statisticsUpdater, &QTimer::timeout, [=]{
+                        statisticsLabel->setText(statisticsText(renderer->statistics()));
+                    });
+                    return statisticsLabel;
+                }());
                 renderSettingsWidget->setLayout(renderSettingsFormLayout);
                 return renderSettingsWidget;
             }());
@@ -260,16 +424,40 @@ namespace photon_mapping {
         }());
         mainWindow->setStatusBar([&]{
             QStatusBar* statusBar = new QStatusBar(mainWindow);
-            //statusBar->addPermanentWidget([&]{
-            //    QLabel* fps = new QLabel(statusBar);
-            //    connect(frameFrequencyMeter, &FrequencyMeter::frequencyChanged, [=](float frequency) {
-            //        fps->setText(QString("FPS: %1").arg(frequency, 0, 'g', 2));
-            //    });
-            //    return fps;
-            //}());
+            statusBar->addPermanentWidget([&]{
+                QLabel* raysPerSecondLabel = new QLabel(statusBar);
+                connect(statisticsUpdater, &QTimer::timeout, [=]{
+                    RendererBase::Statistics statistics = renderer->statistics();
+                    if (statistics.render.empty()) {
+                        raysPerSecondLabel->clear();
+                        return;
+                    }
+                    auto const& render = *statistics.render.rbegin();
+#ifdef PHOTON_MAPPING_COUNTERS
+                    raysPerSecondLabel->setText(QString("Quality %1: %2 ms, %3 Mrays/s")
+                        .arg(render.first)
+                        .arg(render.second.nsecs / 1e6, 0, 'f', 1)
+                        .arg(render.second.nsecs > 0 ? render.second.counters.raysTraced * 1e3 / render.second.nsecs : 0.0, 0, 'f', 2)
+                    );
+#else
+                    raysPerSecondLabel->setText(QString("Quality %1: %2 ms")
+                        .arg(render.first)
+                        .arg(render.second.nsecs / 1e6, 0, 'f', 1)
+                    );
+#endif
+                });
+                return raysPerSecondLabel;
+            }());
             return statusBar;
         }());
         mainWindow->resize(800, 600);
         mainWindow->show();
+
+#ifdef PHOTON_MAPPING_TRACING
+        connect(this, &QCoreApplication::aboutToQuit, [=]{
+            renderer->abort();
+            Trace::instance().save("trace.json");
+        });
+#endif
     }
 }
\ No newline at end of file
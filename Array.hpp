@@ -0,0 +1,85 @@
+#ifndef PHOTON_MAPPING_ARRAY_HPP
+#define PHOTON_MAPPING_ARRAY_HPP
+
+#include <memory>
+#include <vector>
+
+namespace photon_mapping {
+    template <typename T>
+    class Array {
+        public:
+            Array()
+                : m_data(nullptr)
+                , m_size(0)
+            {}
+
+            template <typename ForwardIterator>
+            Array(ForwardIterator begin, ForwardIterator end)
+                : m_elements(begin, end)
+                , m_data(m_elements.data())
+                , m_size(m_elements.size())
+            {}
+
+            explicit Array(std::vector<T>& elements)
+                : m_data(nullptr)
+                , m_size(0)
+            {
+                assign(elements);
+            }
+
+            Array(T const* data, int size, std::shared_ptr<void const> const& storage)
+                : m_data(data)
+                , m_size(size)
+                , m_storage(storage)
+            {}
+
+            void assign(std::vector<T>& elements) {
+                m_elements.swap(elements);
+                m_data = m_elements.data();
+                m_size = m_elements.size();
+                m_storage.reset();
+            }
+
+            void assign(T const* data, int size, std::shared_ptr<void const> const& storage) {
+                std::vector<T>().swap(m_elements);
+                m_data = data;
+                m_size = size;
+                m_storage = storage;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            int size() const {
+                return m_size;
+            }
+
+            T const* data() const {
+                return m_data;
+            }
+
+            T const* begin() const {
+                return m_data;
+            }
+
+            T const* end() const {
+                return m_data + m_size;
+            }
+
+            T const& operator[](int i) const {
+                return m_data[i];
+            }
+
+        private:
+            std::vector<T> m_elements;
+            T const* m_data;
+            int m_size;
+            std::shared_ptr<void const> m_storage;
+
+            Array(Array const&);
+            Array& operator=(Array const&);
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "BatchApplication.hpp"
+
+#include <cstdio>
+
+#include <QStringList>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QImage>
+
+#include "loadObj.hpp"
+#include "Trace.hpp"
+
+namespace photon_mapping {
+    BatchApplication::BatchApplication(int& argc, char** argv)
+        : QCoreApplication(argc, argv)
+        , m_extent(800, 600)
+        , m_cameraPosition(0.0f, 1.0f, 3.0f)
+        , m_cameraYaw(0.0f)
+        , m_cameraPitch(0.0f)
+        , m_cameraFieldOfView(degToRad(60.0f))
+        , m_photonCount(10000)
+        , m_photonGatherCount(100)
+        , m_photonGatherRadius(inf())
+        , m_causticPhotonCount(10000)
+        , m_causticPhotonGatherCount(50)
+        , m_causticPhotonGatherRadius(0.1f)
+        , m_finalGatherRayCount(0)
+        , m_irradianceCacheMaxError(0.2f)
+        , m_maxRayBounceCount(4)
+        , m_initialQuality(0)
+        , m_finalQuality(2)
+        , m_adaptiveThreshold(0.0f)
+    {
+        QStringList paths = libraryPaths();
+        paths.append(".");
+        paths.append("imageformats");
+        setLibraryPaths(paths);
+    }
+
+    int BatchApplication::run() {
+        QTextStream err(stderr);
+        if (!parseArguments()) {
+            printUsage();
+            return 1;
+        }
+
+        auto scene = std::make_shared<Scene>();
+        loadObj(scene, m_objFilePath);
+        if (scene->empty()) {
+            err << "failed to load " << m_objFilePath << "\n";
+            return 1;
+        }
+
+        auto camera = std::make_shared<Camera>();
+        camera->setFieldOfView(m_cameraFieldOfView);
+        camera->setTransformation(
+            Matrix43f::rotation(Vector3f::UNIT_X, m_cameraPitch)
+            * Matrix43f::rotation(Vector3f::UNIT_Y, m_cameraYaw)
+            * Matrix43f::translation(m_cameraPosition)
+        );
+
+        auto surface = std::make_shared<Surface>();
+        surface->setExtent(m_extent);
+
+        auto renderer = std::make_shared<Renderer>();
+        renderer->setScene(scene);
+        renderer->setCamera(camera);
+        renderer->setSurface(surface);
+        renderer->setPhotonCount(m_photonCount);
+        renderer->setPhotonGatherCount(m_photonGatherCount);
+        renderer->setPhotonGatherRadius(m_photonGatherRadius);
+        renderer->setCausticPhotonCount(m_causticPhotonCount);
+        renderer->setCausticPhotonGatherCount(m_causticPhotonGatherCount);
+        renderer->setCausticPhotonGatherRadius(m_causticPhotonGatherRadius);
+        renderer->setFinalGatherRayCount(m_finalGatherRayCount);
+        renderer->setIrradianceCacheMaxError(m_irradianceCacheMaxError);
+        renderer->setMaxRayBounceCount(m_maxRayBounceCount);
+        renderer->setInitialQuality(m_initialQuality);
+        renderer->setFinalQuality(m_finalQuality);
+        renderer->setAdaptiveThreshold(m_adaptiveThreshold);
+        renderer->invalidateScene();
+        renderer->start();
+        renderer->wait();
+
+        if (!surface->image().save(m_imageFilePath)) {
+            err << "failed to save " << m_imageFilePath << "\n";
+            return 1;
+        }
+#ifdef PHOTON_MAPPING_TRACING
+        if (!m_traceFilePath.isEmpty() && !Trace::instance().save(m_traceFilePath)) {
+            err << "failed to save " << m_traceFilePath << "\n";
+            return 1;
+        }
+#endif
+        return 0;
+    }
+
+    bool BatchApplication::parseArguments() {
+        QStringList args = arguments();
+        QStringList positionalArgs;
+        for (int i = 1; i < args.length(); ++i) {
+            QString const& arg = args[i];
+            if (!arg.startsWith("--")) {
+                positionalArgs.append(arg);
+                continue;
+            }
+            if (i + 1 == args.length()) {
+                return false;
+            }
+#ifdef PHOTON_MAPPING_TRACING
+            if (arg == "--trace") {
+                m_traceFilePath = args[++i];
+                continue;
+            }
+#endif
+            QStringList value = args[++i].split(QRegularExpression("[x,]"));
+            bool ok = true;
+            if (arg == "--size" && value.length() == 2) {
+                bool okX, okY;
+                m_extent = Extent2i(value[0].toInt(&okX), value[1].toInt(&okY));
+                ok = okX && okY && m_extent.x > 0 && m_extent.y > 0;
+            } else if (arg == "--position" && value.length() == 3) {
+                bool okX, okY, okZ;
+                m_cameraPosition = Vector3f(value[0].toFloat(&okX), value[1].toFloat(&okY), value[2].toFloat(&okZ));
+                ok = okX && okY && okZ;
+            } else if (arg == "--rotation" && value.length() == 2) {
+                bool okYaw, okPitch;
+                m_cameraYaw = degToRad(value[0].toFloat(&okYaw));
+                m_cameraPitch = degToRad(value[1].toFloat(&okPitch));
+                ok = okYaw && okPitch;
+            } else if (arg == "--fov" && value.length() == 1) {
+                m_cameraFieldOfView = degToRad(value[0].toFloat(&ok));
+            } else if (arg == "--photons" && value.length() == 1) {
+                m_photonCount = value[0].toInt(&ok);
+                ok = ok && m_photonCount > 0;
+            } else if (arg == "--gather" && value.length() == 1) {
+                m_photonGatherCount = value[0].toInt(&ok);
+                ok = ok && m_photonGatherCount > 0;
+            } else if (arg == "--gather-radius" && value.length() == 1) {
+                m_photonGatherRadius = value[0].toFloat(&ok);
+                ok = ok && m_photonGatherRadius > 0.0f;
+            } else if (arg == "--caustic-photons" && value.length() == 1) {
+                m_causticPhotonCount = value[0].toInt(&ok);
+                ok = ok && m_causticPhotonCount >= 0;
+            } else if (arg == "--caustic-gather" && value.length() == 1) {
+                m_causticPhotonGatherCount = value[0].toInt(&ok);
+                ok = ok && m_causticPhotonGatherCount > 0;
+            } else if (arg == "--caustic-gather-radius" && value.length() == 1) {
+                m_causticPhotonGatherRadius = value[0].toFloat(&ok);
+                ok = ok && m_causticPhotonGatherRadius > 0.0f;
+            } else if (arg == "--final-gather" && value.length() == 1) {
+                m_finalGatherRayCount = value[0].toInt(&ok);
+                ok = ok && m_finalGatherRayCount >= 0;
+            } else if (arg == "--irradiance-error" && value.length() == 1) {
+                m_irradianceCacheMaxError = value[0].toFloat(&ok);
+                ok = ok && m_irradianceCacheMaxError > 0.0f;
+            } else if (arg == "--bounces" && value.length() == 1) {
+                m_maxRayBounceCount = value[0].toInt(&ok);
+            } else if (arg == "--initial-quality" && value.length() == 1) {
+                m_initialQuality = value[0].toInt(&ok);
+            } else if (arg == "--final-quality" && value.length() == 1) {
+                m_finalQuality = value[0].toInt(&ok);
+            } else if (arg == "--adaptive-threshold" && value.length() == 1) {
+                m_adaptiveThreshold = value[0].toFloat(&ok);
+                ok = ok && m_adaptiveThreshold >= 0.0f;
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        if (positionalArgs.length() != 2 || m_initialQuality >= m_finalQuality) {
+            return false;
+        }
+        m_objFilePath = positionalArgs[0];
+        m_imageFilePath = positionalArgs[1];
+        return true;
+    }
+
+    void BatchApplication::printUsage() const {
+        QTextStream err(stderr);
+        err << "usage: " << arguments()[0] << " <input.obj> <output image> [options]\n"
+            << "  --size WxH              image size in pixels (800x600)\n"
+            << "  --position X,Y,Z        camera position (0,1,3)\n"
+            << "  --rotation YAW,PITCH    camera rotation in degrees (0,0)\n"
+            << "  --fov DEGREES           vertical field of view (60)\n"
+            << "  --photons N             photon count (10000)\n"
+            << "  --gather N              photon gather count (100)\n"
+            << "  --gather-radius R       max photon gather radius (unlimited)\n"
+            << "  --caustic-photons N     caustic photon count (10000)\n"
+            << "  --caustic-gather N      caustic photon gather count (50)\n"
+            << "  --caustic-gather-radius R  max caustic photon gather radius (0.1)\n"
+            << "  --final-gather N        final gather rays per irradiance sample (0, off)\n"
+            << "  --irradiance-error E    irradiance cache max error (0.2)\n"
+            << "  --bounces N             max ray bounce count (4)\n"
+            << "  --initial-quality N     first quality level rendered (0)\n"
+            << "  --final-quality N       quality level to stop at (2)\n"
+            << "  --adaptive-threshold E  skip pixels below relative error E (0, off)\n"
+#ifdef PHOTON_MAPPING_TRACING
+            << "  --trace FILE            write a Chrome trace of the render to FILE\n"
+#endif
+            ;
+    }
+}
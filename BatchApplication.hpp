@@ -0,0 +1,52 @@
+#ifndef PHOTON_MAPPING_BATCH_APPLICATION_HPP
+#define PHOTON_MAPPING_BATCH_APPLICATION_HPP
+
+#include <memory>
+
+#include <QCoreApplication>
+#include <QString>
+
+#include "Scene.hpp"
+#include "Camera.hpp"
+#include "Surface.hpp"
+#include "Renderer.hpp"
+
+namespace photon_mapping {
+    class BatchApplication
+        : public QCoreApplication
+    {
+        public:
+            BatchApplication(int& argc, char** argv);
+
+            int run();
+
+        private:
+            QString m_objFilePath;
+            QString m_imageFilePath;
+            Extent2i m_extent;
+            Vector3f m_cameraPosition;
+            float m_cameraYaw;
+            float m_cameraPitch;
+            float m_cameraFieldOfView;
+            int m_photonCount;
+            int m_photonGatherCount;
+            float m_photonGatherRadius;
+            int m_causticPhotonCount;
+            int m_causticPhotonGatherCount;
+            float m_causticPhotonGatherRadius;
+            int m_finalGatherRayCount;
+            float m_irradianceCacheMaxError;
+            int m_maxRayBounceCount;
+            int m_initialQuality;
+            int m_finalQuality;
+            float m_adaptiveThreshold;
+#ifdef PHOTON_MAPPING_TRACING
+            QString m_traceFilePath;
+#endif
+
+            bool parseArguments();
+            void printUsage() const;
+    };
+}
+
+#endif
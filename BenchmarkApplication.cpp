@@ -0,0 +1,306 @@
+#include "BenchmarkApplication.hpp"
+
+#include <cstdio>
+#include <memory>
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "Scene.hpp"
+#include "Camera.hpp"
+#include "Surface.hpp"
+#include "loadObj.hpp"
+#include "Trace.hpp"
+
+namespace photon_mapping {
+    namespace {
+        QJsonObject phaseToJson(RendererBase::PhaseStatistics const& phase) {
+            double seconds = phase.nsecs / 1e9;
+            QJsonObject json;
+            json["seconds"] = seconds;
+            json["raysTraced"] = (double)phase.counters.raysTraced;
+            json["raysPerSecond"] = seconds > 0.0 ? phase.counters.raysTraced / seconds : 0.0;
+            json["bihNodesVisited"] = (double)phase.counters.bihNodesVisited;
+            json["trianglesTested"] = (double)phase.counters.trianglesTested;
+            json["photonGathers"] = (double)phase.counters.photonGathers;
+            json["gathersPerSecond"] = seconds > 0.0 ? phase.counters.photonGathers / seconds : 0.0;
+            json["photonHeapOperations"] = (double)phase.counters.photonHeapOperations;
+            json["irradianceCacheHits"] = (double)phase.counters.irradianceCacheHits;
+            json["irradianceCacheMisses"] = (double)phase.counters.irradianceCacheMisses;
+            QJsonArray workers;
+            for (auto const& worker : phase.workers) {
+                QJsonObject workerJson;
+                workerJson["seconds"] = worker.nsecs / 1e9;
+                workerJson["barrierWaitSeconds"] = worker.barrierWaitNsecs / 1e9;
+                workerJson["raysTraced"] = (double)worker.counters.raysTraced;
+                workerJson["photonGathers"] = (double)worker.counters.photonGathers;
+                workers.append(workerJson);
+            }
+            json["workers"] = workers;
+            return json;
+        }
+    }
+
+    BenchmarkApplication::BenchmarkApplication(int& argc, char** argv)
+        : QCoreApplication(argc, argv)
+        , m_modelDirectoryPath("models")
+        , m_extent(640, 480)
+        , m_photonCount(100000)
+        , m_photonGatherCount(100)
+        , m_photonGatherRadius(inf())
+        , m_causticPhotonCount(10000)
+        , m_causticPhotonGatherCount(50)
+        , m_causticPhotonGatherRadius(0.1f)
+        , m_finalGatherRayCount(0)
+        , m_irradianceCacheMaxError(0.2f)
+        , m_maxRayBounceCount(4)
+        , m_initialQuality(-4)
+        , m_finalQuality(2)
+        , m_adaptiveThreshold(0.0f)
+        , m_seed(1)
+    {
+        QStringList paths = libraryPaths();
+        paths.append(".");
+        paths.append("imageformats");
+        setLibraryPaths(paths);
+
+        m_modelNames
+            << "CornellBox-Original"
+            << "CornellBox-Glossy"
+            << "CornellBox-Mirror"
+            << "CornellBox-Sphere"
+            << "CornellBox-Water"
+            << "CornellBox-Mapping";
+    }
+
+    int BenchmarkApplication::run() {
+        QTextStream err(stderr);
+        if (!parseArguments()) {
+            printUsage();
+            return 1;
+        }
+
+        QJsonArray models;
+        for (auto const& modelName : m_modelNames) {
+            err << "running " << modelName << "\n";
+            err.flush();
+            QJsonObject model = runModel(modelName);
+            if (model.isEmpty()) {
+                err << "failed to load " << modelName << "\n";
+                return 1;
+            }
+            models.append(model);
+        }
+
+        QJsonObject report;
+        report["settings"] = settings();
+        report["models"] = models;
+        QByteArray reportJson = QJsonDocument(report).toJson();
+
+        QFile outputFile(m_outputFilePath);
+        bool opened = m_outputFilePath.isEmpty()
+            ? outputFile.open(stdout, QIODevice::WriteOnly)
+            : outputFile.open(QIODevice::WriteOnly);
+        if (!opened || outputFile.write(reportJson) != reportJson.size()) {
+            err << "failed to write report\n";
+            return 1;
+        }
+#ifdef PHOTON_MAPPING_TRACING
+        if (!m_traceFilePath.isEmpty() && !Trace::instance().save(m_traceFilePath)) {
+            err << "failed to save " << m_traceFilePath << "\n";
+            return 1;
+        }
+#endif
+        return 0;
+    }
+
+    QJsonObject BenchmarkApplication::settings() const {
+        QJsonObject json;
+        json["width"] = m_extent.x;
+        json["height"] = m_extent.y;
+        json["photonCount"] = m_photonCount;
+        json["photonGatherCount"] = m_photonGatherCount;
+        json["photonGatherRadius"] = m_photonGatherRadius;
+        json["causticPhotonCount"] = m_causticPhotonCount;
+        json["causticPhotonGatherCount"] = m_causticPhotonGatherCount;
+        json["causticPhotonGatherRadius"] = m_causticPhotonGatherRadius;
+        json["finalGatherRayCount"] = m_finalGatherRayCount;
+        json["irradianceCacheMaxError"] = m_irradianceCacheMaxError;
+        json["maxRayBounceCount"] = m_maxRayBounceCount;
+        json["initialQuality"] = m_initialQuality;
+        json["finalQuality"] = m_finalQuality;
+        json["adaptiveThreshold"] = m_adaptiveThreshold;
+        json["seed"] = (double)m_seed;
+        json["workerCount"] = QThread::idealThreadCount();
+        return json;
+    }
+
+    QJsonObject BenchmarkApplication::runModel(QString const& modelName) {
+        QElapsedTimer loadTimer;
+        loadTimer.start();
+        auto scene = std::make_shared<Scene>();
+        LoadObjStatistics loadStatistics;
+        loadObj(scene, QDir(m_modelDirectoryPath).filePath(modelName + ".obj"), &loadStatistics);
+        if (scene->empty()) {
+            return QJsonObject();
+        }
+        double loadSeconds = loadTimer.nsecsElapsed() / 1e9;
+
+        auto camera = std::make_shared<Camera>();
+        camera->setFieldOfView(degToRad(60.0f));
+        camera->setTransformation(
+            camera->transformation()
+            * Matrix43f::translation(Vector3f(0.0f, 1.0f, 3.0f))
+        );
+
+        auto surface = std::make_shared<Surface>();
+        surface->setExtent(m_extent);
+
+        auto renderer = std::make_shared<Renderer>();
+        renderer->setScene(scene);
+        renderer->setCamera(camera);
+        renderer->setSurface(surface);
+        renderer->setPhotonCount(m_photonCount);
+        renderer->setPhotonGatherCount(m_photonGatherCount);
+        renderer->setPhotonGatherRadius(m_photonGatherRadius);
+        renderer->setCausticPhotonCount(m_causticPhotonCount);
+        renderer->setCausticPhotonGatherCount(m_causticPhotonGatherCount);
+        renderer->setCausticPhotonGatherRadius(m_causticPhotonGatherRadius);
+        renderer->setFinalGatherRayCount(m_finalGatherRayCount);
+        renderer->setIrradianceCacheMaxError(m_irradianceCacheMaxError);
+        renderer->setMaxRayBounceCount(m_maxRayBounceCount);
+        renderer->setInitialQuality(m_initialQuality);
+        renderer->setFinalQuality(m_finalQuality);
+        renderer->setAdaptiveThreshold(m_adaptiveThreshold);
+        renderer->setSeed(m_seed);
+        renderer->invalidateScene();
+        renderer->start();
+        renderer->wait();
+
+        RendererBase::Statistics statistics = renderer->statistics();
+
+        QJsonObject scatter = phaseToJson(statistics.scatter);
+        double scatterSeconds = statistics.scatter.nsecs / 1e9;
+        scatter["photonsPerSecond"] = scatterSeconds > 0.0 ? (m_photonCount + m_causticPhotonCount) / scatterSeconds : 0.0;
+
+        QJsonArray render;
+        for (auto const& quality : statistics.render) {
+            QJsonObject renderQuality = phaseToJson(quality.second);
+            renderQuality["quality"] = quality.first;
+            render.append(renderQuality);
+        }
+
+        QJsonObject json;
+        json["name"] = modelName;
+        json["loadSeconds"] = loadSeconds;
+        json["loadEstimatedPeakBytes"] = (double)loadStatistics.estimatedPeakBytes;
+        json["loadMeshBytes"] = (double)loadStatistics.meshBytes;
+        json["loadCached"] = loadStatistics.cached;
+        json["scatter"] = scatter;
+        json["mapBuild"] = phaseToJson(statistics.mapBuild);
+        json["render"] = render;
+        return json;
+    }
+
+    bool BenchmarkApplication::parseArguments() {
+        QStringList args = arguments();
+        for (int i = 1; i < args.length(); ++i) {
+            QString const& arg = args[i];
+            if (i + 1 == args.length()) {
+                return false;
+            }
+            QString const& value = args[++i];
+            bool ok = true;
+            if (arg == "--models") {
+                m_modelDirectoryPath = value;
+            } else if (arg == "--only") {
+                m_modelNames = value.split(',');
+            } else if (arg == "--output") {
+                m_outputFilePath = value;
+            } else if (arg == "--size") {
+                QStringList size = value.split('x');
+                bool okX = false, okY = false;
+                if (size.length() == 2) {
+                    m_extent = Extent2i(size[0].toInt(&okX), size[1].toInt(&okY));
+                }
+                ok = okX && okY && m_extent.x > 0 && m_extent.y > 0;
+            } else if (arg == "--photons") {
+                m_photonCount = value.toInt(&ok);
+                ok = ok && m_photonCount > 0;
+            } else if (arg == "--gather") {
+                m_photonGatherCount = value.toInt(&ok);
+                ok = ok && m_photonGatherCount > 0;
+            } else if (arg == "--gather-radius") {
+                m_photonGatherRadius = value.toFloat(&ok);
+                ok = ok && m_photonGatherRadius > 0.0f;
+            } else if (arg == "--caustic-photons") {
+                m_causticPhotonCount = value.toInt(&ok);
+                ok = ok && m_causticPhotonCount >= 0;
+            } else if (arg == "--caustic-gather") {
+                m_causticPhotonGatherCount = value.toInt(&ok);
+                ok = ok && m_causticPhotonGatherCount > 0;
+            } else if (arg == "--caustic-gather-radius") {
+                m_causticPhotonGatherRadius = value.toFloat(&ok);
+                ok = ok && m_causticPhotonGatherRadius > 0.0f;
+            } else if (arg == "--final-gather") {
+                m_finalGatherRayCount = value.toInt(&ok);
+                ok = ok && m_finalGatherRayCount >= 0;
+            } else if (arg == "--irradiance-error") {
+                m_irradianceCacheMaxError = value.toFloat(&ok);
+                ok = ok && m_irradianceCacheMaxError > 0.0f;
+            } else if (arg == "--bounces") {
+                m_maxRayBounceCount = value.toInt(&ok);
+            } else if (arg == "--initial-quality") {
+                m_initialQuality = value.toInt(&ok);
+            } else if (arg == "--final-quality") {
+                m_finalQuality = value.toInt(&ok);
+            } else if (arg == "--adaptive-threshold") {
+                m_adaptiveThreshold = value.toFloat(&ok);
+                ok = ok && m_adaptiveThreshold >= 0.0f;
+            } else if (arg == "--seed") {
+                m_seed = value.toUInt(&ok);
+#ifdef PHOTON_MAPPING_TRACING
+            } else if (arg == "--trace") {
+                m_traceFilePath = value;
+#endif
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        return m_initialQuality < m_finalQuality;
+    }
+
+    void BenchmarkApplication::printUsage() const {
+        QTextStream err(stderr);
+        err << "usage: " << arguments()[0] << " [options]\n"
+            << "  --models DIR            directory with the Cornell box models (models)\n"
+            << "  --only NAME,...         run only the listed models\n"
+            << "  --output FILE           write the JSON report to FILE (stdout)\n"
+            << "  --size WxH              image size in pixels (640x480)\n"
+            << "  --photons N             photon count (100000)\n"
+            << "  --gather N              photon gather count (100)\n"
+            << "  --gather-radius R       max photon gather radius (unlimited)\n"
+            << "  --caustic-photons N     caustic photon count (10000)\n"
+            << "  --caustic-gather N      caustic photon gather count (50)\n"
+            << "  --caustic-gather-radius R  max caustic photon gather radius (0.1)\n"
+            << "  --final-gather N        final gather rays per irradiance sample (0, off)\n"
+            << "  --irradiance-error E    irradiance cache max error (0.2)\n"
+            << "  --bounces N             max ray bounce count (4)\n"
+            << "  --initial-quality N     first quality level rendered (-4)\n"
+            << "  --final-quality N       quality level to stop at (2)\n"
+            << "  --adaptive-threshold E  skip pixels below relative error E (0, off)\n"
+            << "  --seed N                photon scattering seed (1)\n"
+#ifdef PHOTON_MAPPING_TRACING
+            << "  --trace FILE            write a Chrome trace of all runs to FILE\n"
+#endif
+            ;
+    }
+}
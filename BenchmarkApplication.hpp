@@ -0,0 +1,52 @@
+#ifndef PHOTON_MAPPING_BENCHMARK_APPLICATION_HPP
+#define PHOTON_MAPPING_BENCHMARK_APPLICATION_HPP
+
+#include <cstdint>
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+#include "Extent.hpp"
+#include "Renderer.hpp"
+
+namespace photon_mapping {
+    class BenchmarkApplication
+        : public QCoreApplication
+    {
+        public:
+            BenchmarkApplication(int& argc, char** argv);
+
+            int run();
+
+        private:
+            QString m_modelDirectoryPath;
+            QStringList m_modelNames;
+            QString m_outputFilePath;
+            Extent2i m_extent;
+            int m_photonCount;
+            int m_photonGatherCount;
+            float m_photonGatherRadius;
+            int m_causticPhotonCount;
+            int m_causticPhotonGatherCount;
+            float m_causticPhotonGatherRadius;
+            int m_finalGatherRayCount;
+            float m_irradianceCacheMaxError;
+            int m_maxRayBounceCount;
+            int m_initialQuality;
+            int m_finalQuality;
+            float m_adaptiveThreshold;
+            std::uint32_t m_seed;
+#ifdef PHOTON_MAPPING_TRACING
+            QString m_traceFilePath;
+#endif
+
+            bool parseArguments();
+            void printUsage() const;
+            QJsonObject settings() const;
+            QJsonObject runModel(QString const& modelName);
+    };
+}
+
+#endif
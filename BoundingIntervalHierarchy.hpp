@@ -8,26 +8,29 @@
 #include "Vector.hpp"
 #include "Segment.hpp"
 #include "Ray.hpp"
+#include "Array.hpp"
+#include "Counters.hpp"
+#include "Trace.hpp"
 
 namespace photon_mapping {
     template <typename Primitive>
     struct BoundingIntervalHierarchyPrimitiveTraits {
-        typedef typename Primitive::Sample Sample;
+        typedef typename Primitive::Hit Hit;
         static Segment3f bound(Primitive const& primitive) {
             return primitive.bound();
         }
-        static bool hit(Primitive const& primitive, Ray const& ray, float& hitDistance, Sample& hit) {
+        static bool hit(Primitive const& primitive, Ray const& ray, float& hitDistance, Hit& hit) {
             return primitive.hit(ray, hitDistance, hit);
         }
     };
 
     template <typename Primitive>
     struct BoundingIntervalHierarchyPrimitiveTraits<std::shared_ptr<Primitive>> {
-        typedef typename BoundingIntervalHierarchyPrimitiveTraits<Primitive>::Sample Sample;
+        typedef typename BoundingIntervalHierarchyPrimitiveTraits<Primitive>::Hit Hit;
         static Segment3f bound(std::shared_ptr<Primitive> const& primitive) {
             return BoundingIntervalHierarchyPrimitiveTraits<Primitive>::bound(*primitive);
         }
-        static bool hit(std::shared_ptr<Primitive> const& primitive, Ray const& ray, float& hitDistance, Sample& hit) {
+        static bool hit(std::shared_ptr<Primitive> const& primitive, Ray const& ray, float& hitDistance, Hit& hit) {
             return BoundingIntervalHierarchyPrimitiveTraits<Primitive>::hit(*primitive, ray, hitDistance, hit);
         }
     };
@@ -35,34 +38,33 @@ namespace photon_mapping {
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits = BoundingIntervalHierarchyPrimitiveTraits<Primitive>>
     class BoundingIntervalHierarchy {
         public:
+            struct Node {
+                int axis;
+                float belowEdge; float aboveEdge;
+                int below; int above;
+                int primitiveIndicesBegin; int primitiveIndicesEnd;
+            };
+
             BoundingIntervalHierarchy(PrimitiveIterator primitivesBegin, PrimitiveIterator primitivesEnd);
+            BoundingIntervalHierarchy(PrimitiveIterator primitivesBegin, Segment3f const& bound, Node const* nodes, int nodeCount, int const* primitiveIndices, int primitiveIndexCount, std::shared_ptr<void const> const& storage);
 
             void rebuild(PrimitiveIterator primitivesBegin, PrimitiveIterator primitivesEnd);
 
             Segment3f bound() const;
-            bool hit(Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const;
+            Array<Node> const& nodes() const;
+            Array<int> const& primitiveIndices() const;
+            bool hit(Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const;
 
         private:
-            class Node {
-                public:
-                    Node(Segment3f const& bound, typename std::vector<PrimitiveIterator>::iterator primitiveIteratorsBegin, typename std::vector<PrimitiveIterator>::iterator primitiveIteratorsEnd);
-
-                    bool hit(float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const;
-
-                private:
-                    int m_axis;
-                    float m_belowEdge; float m_aboveEdge;
-                    std::unique_ptr<Node> m_below; std::unique_ptr<Node> m_above;
-                    typename std::vector<PrimitiveIterator>::const_iterator m_primitiveIteratorsBegin;
-                    typename std::vector<PrimitiveIterator>::const_iterator m_primitiveIteratorsEnd;
-
-                    bool hitLeaf(float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const;
-                    bool hitFork(float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const;
-            };
-
+            PrimitiveIterator m_primitivesBegin;
             Segment3f m_bound;
-            std::vector<PrimitiveIterator> m_primitiveIterators;
-            std::unique_ptr<Node> m_root;
+            Array<Node> m_nodes;
+            Array<int> m_primitiveIndices;
+
+            int build(std::vector<Node>& nodes, std::vector<int>& primitiveIndices, Segment3f const& bound, int primitiveIndicesBegin, int primitiveIndicesEnd) const;
+            bool hitNode(int node, float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const;
+            bool hitLeaf(Node const& node, float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const;
+            bool hitFork(Node const& node, float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const;
     };
 }
 
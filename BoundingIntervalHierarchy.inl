@@ -4,15 +4,28 @@ namespace photon_mapping {
         rebuild(primitivesBegin, primitivesEnd);
     }
 
+    template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
+    BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::BoundingIntervalHierarchy(PrimitiveIterator primitivesBegin, Segment3f const& bound, Node const* nodes, int nodeCount, int const* primitiveIndices, int primitiveIndexCount, std::shared_ptr<void const> const& storage)
+        : m_primitivesBegin(primitivesBegin)
+        , m_bound(bound)
+        , m_nodes(nodes, nodeCount, storage)
+        , m_primitiveIndices(primitiveIndices, primitiveIndexCount, storage)
+    {}
+
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
     void BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::rebuild(PrimitiveIterator primitivesBegin, PrimitiveIterator primitivesEnd) {
+        PHOTON_MAPPING_TRACE_SCOPE("BIH build");
+        m_primitivesBegin = primitivesBegin;
         m_bound = Segment3f::NOTHING;
-        m_primitiveIterators.clear();
+        std::vector<int> primitiveIndices;
         for (auto primitive = primitivesBegin; primitive != primitivesEnd; ++primitive) {
-            m_primitiveIterators.push_back(primitive);
+            primitiveIndices.push_back(primitiveIndices.size());
             m_bound |= PrimitiveTraits::bound(*primitive);
         }
-        m_root = std::unique_ptr<Node>(new Node(m_bound, m_primitiveIterators.begin(), m_primitiveIterators.end()));
+        std::vector<Node> nodes;
+        build(nodes, primitiveIndices, m_bound, 0, primitiveIndices.size());
+        m_nodes.assign(nodes);
+        m_primitiveIndices.assign(primitiveIndices);
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
@@ -21,96 +34,116 @@ namespace photon_mapping {
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
-    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::hit(Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const {
+    inline Array<typename BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::Node> const& BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::nodes() const {
+        return m_nodes;
+    }
+
+    template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
+    inline Array<int> const& BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::primitiveIndices() const {
+        return m_primitiveIndices;
+    }
+
+    template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
+    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::hit(Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const {
         float minDistance, maxDistance;
-        if (!m_bound.hit(ray, minDistance, maxDistance)) {
+        if (m_nodes.empty() || !m_bound.hit(ray, minDistance, maxDistance)) {
             return false;
         }
-        return m_root->hit(minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
+        return hitNode(0, minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
-    BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::Node::Node(Segment3f const& bound, typename std::vector<PrimitiveIterator>::iterator primitiveIteratorsBegin, typename std::vector<PrimitiveIterator>::iterator primitiveIteratorsEnd) {
-        m_axis = maxAxis(bound);
-        float split = center(bound)[m_axis];
-        auto belowPrimitiveIteratorsBegin = primitiveIteratorsBegin;
-        auto belowPrimitiveIteratorsEnd = primitiveIteratorsBegin; 
-        auto abovePrimitiveIteratorsBegin = primitiveIteratorsEnd;
-        auto abovePrimitiveIteratorsEnd = primitiveIteratorsEnd;
+    int BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::build(std::vector<Node>& nodes, std::vector<int>& primitiveIndices, Segment3f const& bound, int primitiveIndicesBegin, int primitiveIndicesEnd) const {
+        int index = nodes.size();
+        nodes.push_back(Node());
+        Node node;
+        node.axis = maxAxis(bound);
+        node.below = -1;
+        node.above = -1;
+        node.primitiveIndicesBegin = primitiveIndicesBegin;
+        node.primitiveIndicesEnd = primitiveIndicesEnd;
+        float split = center(bound)[node.axis];
+        int belowPrimitiveIndicesBegin = primitiveIndicesBegin;
+        int belowPrimitiveIndicesEnd = primitiveIndicesBegin;
+        int abovePrimitiveIndicesBegin = primitiveIndicesEnd;
+        int abovePrimitiveIndicesEnd = primitiveIndicesEnd;
         while (true) {
-            while ((belowPrimitiveIteratorsEnd < abovePrimitiveIteratorsBegin) && (center(PrimitiveTraits::bound(**belowPrimitiveIteratorsEnd))[m_axis] <= split)) {
-                ++belowPrimitiveIteratorsEnd;
+            while ((belowPrimitiveIndicesEnd < abovePrimitiveIndicesBegin) && (center(PrimitiveTraits::bound(m_primitivesBegin[primitiveIndices[belowPrimitiveIndicesEnd]]))[node.axis] <= split)) {
+                ++belowPrimitiveIndicesEnd;
             }
-            while ((belowPrimitiveIteratorsEnd < abovePrimitiveIteratorsBegin) && (split < center(PrimitiveTraits::bound(**(abovePrimitiveIteratorsBegin - 1)))[m_axis])) {
-                --abovePrimitiveIteratorsBegin;
-            } 
-            if (belowPrimitiveIteratorsEnd == abovePrimitiveIteratorsBegin) {
+            while ((belowPrimitiveIndicesEnd < abovePrimitiveIndicesBegin) && (split < center(PrimitiveTraits::bound(m_primitivesBegin[primitiveIndices[abovePrimitiveIndicesBegin - 1]]))[node.axis])) {
+                --abovePrimitiveIndicesBegin;
+            }
+            if (belowPrimitiveIndicesEnd == abovePrimitiveIndicesBegin) {
                 break;
             }
-            std::swap(*belowPrimitiveIteratorsEnd, *(abovePrimitiveIteratorsBegin - 1));
+            std::swap(primitiveIndices[belowPrimitiveIndicesEnd], primitiveIndices[abovePrimitiveIndicesBegin - 1]);
         }
-        m_belowEdge = bound.min[m_axis];
-        for (auto i = belowPrimitiveIteratorsBegin; i < belowPrimitiveIteratorsEnd; ++i) {
-            m_belowEdge = max(m_belowEdge, PrimitiveTraits::bound(**i).max[m_axis]);
+        node.belowEdge = bound.min[node.axis];
+        for (int i = belowPrimitiveIndicesBegin; i < belowPrimitiveIndicesEnd; ++i) {
+            node.belowEdge = max(node.belowEdge, PrimitiveTraits::bound(m_primitivesBegin[primitiveIndices[i]]).max[node.axis]);
         }
-        m_aboveEdge = bound.max[m_axis];
-        for (auto i = abovePrimitiveIteratorsBegin; i < abovePrimitiveIteratorsEnd; ++i) {
-            m_aboveEdge = min(m_aboveEdge, PrimitiveTraits::bound(**i).min[m_axis]);
+        node.aboveEdge = bound.max[node.axis];
+        for (int i = abovePrimitiveIndicesBegin; i < abovePrimitiveIndicesEnd; ++i) {
+            node.aboveEdge = min(node.aboveEdge, PrimitiveTraits::bound(m_primitivesBegin[primitiveIndices[i]]).min[node.axis]);
         }
 
-        if (((belowPrimitiveIteratorsEnd == primitiveIteratorsEnd) && (m_belowEdge == bound.max[m_axis])) || ((abovePrimitiveIteratorsBegin == primitiveIteratorsBegin) && (m_aboveEdge == bound.min[m_axis]))) {
-            m_axis = -1;
-            m_primitiveIteratorsBegin = primitiveIteratorsBegin;
-            m_primitiveIteratorsEnd = primitiveIteratorsEnd;
-            return;
+        if (((belowPrimitiveIndicesEnd == primitiveIndicesEnd) && (node.belowEdge == bound.max[node.axis])) || ((abovePrimitiveIndicesBegin == primitiveIndicesBegin) && (node.aboveEdge == bound.min[node.axis]))) {
+            node.axis = -1;
+            nodes[index] = node;
+            return index;
         }
 
-        if (belowPrimitiveIteratorsBegin != belowPrimitiveIteratorsEnd) {
+        if (belowPrimitiveIndicesBegin != belowPrimitiveIndicesEnd) {
             Segment3f belowBound = bound;
-            belowBound.max[m_axis] = m_belowEdge;
-            m_below = std::unique_ptr<Node>(new Node(belowBound, belowPrimitiveIteratorsBegin, belowPrimitiveIteratorsEnd));
+            belowBound.max[node.axis] = node.belowEdge;
+            node.below = build(nodes, primitiveIndices, belowBound, belowPrimitiveIndicesBegin, belowPrimitiveIndicesEnd);
         }
 
-        if (abovePrimitiveIteratorsBegin != abovePrimitiveIteratorsEnd) {
+        if (abovePrimitiveIndicesBegin != abovePrimitiveIndicesEnd) {
             Segment3f aboveBound = bound;
-            aboveBound.min[m_axis] = m_aboveEdge;
-            m_above = std::unique_ptr<Node>(new Node(aboveBound, abovePrimitiveIteratorsBegin, abovePrimitiveIteratorsEnd));
+            aboveBound.min[node.axis] = node.aboveEdge;
+            node.above = build(nodes, primitiveIndices, aboveBound, abovePrimitiveIndicesBegin, abovePrimitiveIndicesEnd);
         }
+
+        nodes[index] = node;
+        return index;
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
-    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::Node::hit(float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const {
-        if (m_axis == -1) {
-            return hitLeaf(minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
+    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::hitNode(int node, float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const {
+        PHOTON_MAPPING_COUNT(bihNodesVisited, 1);
+        if (m_nodes[node].axis == -1) {
+            return hitLeaf(m_nodes[node], minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
         } else {
-            return hitFork(minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
+            return hitFork(m_nodes[node], minDistance, maxDistance, ray, hitDistance, hit, hitPrimitiveIterator);
         }
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
-    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::Node::hitFork(float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const {
-        float belowEdgeDistance = (m_belowEdge - ray.origin[m_axis]) / ray.direction[m_axis];
-        float aboveEdgeDistance = (m_aboveEdge - ray.origin[m_axis]) / ray.direction[m_axis];
-        Node* lo = m_below.get();
-        Node* hi = m_above.get();
+    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::hitFork(Node const& node, float minDistance, float maxDistance, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const {
+        float belowEdgeDistance = (node.belowEdge - ray.origin[node.axis]) / ray.direction[node.axis];
+        float aboveEdgeDistance = (node.aboveEdge - ray.origin[node.axis]) / ray.direction[node.axis];
+        int lo = node.below;
+        int hi = node.above;
         float loEdgeDistance = belowEdgeDistance;
         float hiEdgeDistance = aboveEdgeDistance;
-        if (ray.direction[m_axis] < 0.0f) {
+        if (ray.direction[node.axis] < 0.0f) {
             std::swap(lo, hi);
             std::swap(loEdgeDistance, hiEdgeDistance);
         }
         if (loEdgeDistance <= hiEdgeDistance) {
-            if (lo && (minDistance <= loEdgeDistance) && lo->hit(minDistance, min(loEdgeDistance, maxDistance), ray, hitDistance, hit, hitPrimitiveIterator)) {
+            if ((lo != -1) && (minDistance <= loEdgeDistance) && hitNode(lo, minDistance, min(loEdgeDistance, maxDistance), ray, hitDistance, hit, hitPrimitiveIterator)) {
                 return true;
             }
-            if (hi && (hiEdgeDistance <= maxDistance) && hi->hit(max(minDistance, hiEdgeDistance), maxDistance, ray, hitDistance, hit, hitPrimitiveIterator)) {
+            if ((hi != -1) && (hiEdgeDistance <= maxDistance) && hitNode(hi, max(minDistance, hiEdgeDistance), maxDistance, ray, hitDistance, hit, hitPrimitiveIterator)) {
                 return true;
             }
             return false;
         } else {
             bool hitHappened = false;
-            float loHitDistance; typename PrimitiveTraits::Sample loHit; PrimitiveIterator loHitPrimitiveIterator;
-            if (lo && (minDistance <= loEdgeDistance) && lo->hit(minDistance, min(loEdgeDistance, maxDistance), ray, loHitDistance, loHit, loHitPrimitiveIterator)) {
+            float loHitDistance; typename PrimitiveTraits::Hit loHit; PrimitiveIterator loHitPrimitiveIterator;
+            if ((lo != -1) && (minDistance <= loEdgeDistance) && hitNode(lo, minDistance, min(loEdgeDistance, maxDistance), ray, loHitDistance, loHit, loHitPrimitiveIterator)) {
                 if (!hitHappened || (loHitDistance < hitDistance)) {
                     hitDistance = loHitDistance;
                     hit = loHit;
@@ -118,8 +151,8 @@ namespace photon_mapping {
                     hitHappened = true;
                 }
             }
-            float hiHitDistance; typename PrimitiveTraits::Sample hiHit; PrimitiveIterator hiHitPrimitiveIterator;
-            if (hi && (hiEdgeDistance <= maxDistance) && hi->hit(max(minDistance, hiEdgeDistance), maxDistance, ray, hiHitDistance, hiHit, hiHitPrimitiveIterator)) {
+            float hiHitDistance; typename PrimitiveTraits::Hit hiHit; PrimitiveIterator hiHitPrimitiveIterator;
+            if ((hi != -1) && (hiEdgeDistance <= maxDistance) && hitNode(hi, max(minDistance, hiEdgeDistance), maxDistance, ray, hiHitDistance, hiHit, hiHitPrimitiveIterator)) {
                 if (!hitHappened || (hiHitDistance < hitDistance)) {
                     hitDistance = hiHitDistance;
                     hit = hiHit;
@@ -132,15 +165,16 @@ namespace photon_mapping {
     }
 
     template <typename Primitive, typename PrimitiveIterator, typename PrimitiveTraits>
-    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::Node::hitLeaf(float, float, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Sample& hit, PrimitiveIterator& hitPrimitiveIterator) const {
+    inline bool BoundingIntervalHierarchy<Primitive, PrimitiveIterator, PrimitiveTraits>::hitLeaf(Node const& node, float, float, Ray const& ray, float& hitDistance, typename PrimitiveTraits::Hit& hit, PrimitiveIterator& hitPrimitiveIterator) const {
         bool triangleHitHappened = false;
-        for (auto i = m_primitiveIteratorsBegin; i != m_primitiveIteratorsEnd; ++i) {
-            float triangleHitDistance; typename PrimitiveTraits::Sample triangleHit; 
-            if (PrimitiveTraits::hit(**i, ray, triangleHitDistance, triangleHit)) {
+        for (int i = node.primitiveIndicesBegin; i != node.primitiveIndicesEnd; ++i) {
+            PrimitiveIterator primitive = m_primitivesBegin + m_primitiveIndices[i];
+            float triangleHitDistance; typename PrimitiveTraits::Hit triangleHit; 
+            if (PrimitiveTraits::hit(*primitive, ray, triangleHitDistance, triangleHit)) {
                 if (!triangleHitHappened || (triangleHitDistance < hitDistance)) {
                     hitDistance = triangleHitDistance;
                     hit = triangleHit;
-                    hitPrimitiveIterator = *i;
+                    hitPrimitiveIterator = primitive;
                     triangleHitHappened = true;
                 }
             }
@@ -0,0 +1,7 @@
+#include "Counters.hpp"
+
+namespace photon_mapping {
+    namespace internals {
+        PHOTON_MAPPING_THREAD_LOCAL Counters* currentCounters = nullptr;
+    }
+}
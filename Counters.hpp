@@ -0,0 +1,54 @@
+#ifndef PHOTON_MAPPING_COUNTERS_HPP
+#define PHOTON_MAPPING_COUNTERS_HPP
+
+#include <QtGlobal>
+
+#ifdef _MSC_VER
+    #define PHOTON_MAPPING_THREAD_LOCAL __declspec(thread)
+#else
+    #define PHOTON_MAPPING_THREAD_LOCAL __thread
+#endif
+
+#ifdef PHOTON_MAPPING_COUNTERS
+    #define PHOTON_MAPPING_COUNT(counter, n) \
+        do { \
+            if (photon_mapping::Counters* counters_ = photon_mapping::Counters::current()) { \
+                counters_->counter += (n); \
+            } \
+        } while (false)
+#else
+    #define PHOTON_MAPPING_COUNT(counter, n) do {} while (false)
+#endif
+
+namespace photon_mapping {
+    struct Counters {
+        qint64 raysTraced;
+        qint64 bihNodesVisited;
+        qint64 trianglesTested;
+        qint64 photonGathers;
+        qint64 photonHeapOperations;
+        qint64 irradianceCacheHits;
+        qint64 irradianceCacheMisses;
+
+        Counters();
+
+        static Counters* current();
+        static void setCurrent(Counters* counters);
+    };
+
+    Counters operator+(Counters const& a, Counters const& b);
+    Counters& operator+=(Counters& a, Counters const& b);
+
+    class CountersScope {
+        public:
+            CountersScope(Counters& counters);
+            ~CountersScope();
+
+        private:
+            Counters* m_previous;
+    };
+}
+
+#include "Counters.inl"
+
+#endif
@@ -0,0 +1,49 @@
+namespace photon_mapping {
+    namespace internals {
+        extern PHOTON_MAPPING_THREAD_LOCAL Counters* currentCounters;
+    }
+
+    inline Counters::Counters()
+        : raysTraced(0)
+        , bihNodesVisited(0)
+        , trianglesTested(0)
+        , photonGathers(0)
+        , photonHeapOperations(0)
+        , irradianceCacheHits(0)
+        , irradianceCacheMisses(0)
+    {}
+
+    inline Counters* Counters::current() {
+        return internals::currentCounters;
+    }
+
+    inline void Counters::setCurrent(Counters* counters) {
+        internals::currentCounters = counters;
+    }
+
+    inline Counters operator+(Counters const& a, Counters const& b) {
+        Counters c = a;
+        return c += b;
+    }
+
+    inline Counters& operator+=(Counters& a, Counters const& b) {
+        a.raysTraced += b.raysTraced;
+        a.bihNodesVisited += b.bihNodesVisited;
+        a.trianglesTested += b.trianglesTested;
+        a.photonGathers += b.photonGathers;
+        a.photonHeapOperations += b.photonHeapOperations;
+        a.irradianceCacheHits += b.irradianceCacheHits;
+        a.irradianceCacheMisses += b.irradianceCacheMisses;
+        return a;
+    }
+
+    inline CountersScope::CountersScope(Counters& counters)
+        : m_previous(Counters::current())
+    {
+        Counters::setCurrent(&counters);
+    }
+
+    inline CountersScope::~CountersScope() {
+        Counters::setCurrent(m_previous);
+    }
+}
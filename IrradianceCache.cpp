@@ -0,0 +1,158 @@
+#include "IrradianceCache.hpp"
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "mathFunctions.hpp"
+
+namespace photon_mapping {
+    namespace {
+        bool looselyContains(Point3f const& center, float halfSize, Point3f const& position) {
+            return abs(position.x - center.x) <= halfSize
+                && abs(position.y - center.y) <= halfSize
+                && abs(position.z - center.z) <= halfSize;
+        }
+
+        int childIndex(Point3f const& center, Point3f const& position) {
+            return ((position.x < center.x) ? 0 : 1)
+                | ((position.y < center.y) ? 0 : 2)
+                | ((position.z < center.z) ? 0 : 4);
+        }
+
+        Point3f childCenter(Point3f const& center, float halfSize, int child) {
+            float quarterSize = halfSize / 2.0f;
+            return center + Vector3f(
+                (child & 1) ? +quarterSize : -quarterSize,
+                (child & 2) ? +quarterSize : -quarterSize,
+                (child & 4) ? +quarterSize : -quarterSize
+            );
+        }
+    }
+
+    IrradianceCache::Node::Node() {
+        for (int child = 0; child < 8; ++child) {
+            children[child] = -1;
+        }
+    }
+
+    IrradianceCache::IrradianceCache()
+        : m_maxError(0.2f)
+        , m_center(Point3f::ORIGIN)
+        , m_halfSize(0.0f)
+        , m_nodes(1)
+    {}
+
+    void IrradianceCache::setMaxError(float maxError) {
+        QWriteLocker guardLocker(&m_guard);
+        m_maxError = maxError;
+        m_records.clear();
+        m_nodes.assign(1, Node());
+    }
+
+    void IrradianceCache::reset(Segment3f const& bound) {
+        QWriteLocker guardLocker(&m_guard);
+        m_center = Point3f(
+            (bound.min.x + bound.max.x) / 2.0f,
+            (bound.min.y + bound.max.y) / 2.0f,
+            (bound.min.z + bound.max.z) / 2.0f
+        );
+        m_halfSize = max(max(bound.max.x - bound.min.x, bound.max.y - bound.min.y), bound.max.z - bound.min.z) / 2.0f;
+        m_records.clear();
+        m_records.shrink_to_fit();
+        m_nodes.assign(1, Node());
+        m_nodes.shrink_to_fit();
+    }
+
+    void IrradianceCache::reset(IrradianceCache const& cache) {
+        QReadLocker cacheGuardLocker(&cache.m_guard);
+        QWriteLocker guardLocker(&m_guard);
+        m_maxError = cache.m_maxError;
+        m_center = cache.m_center;
+        m_halfSize = cache.m_halfSize;
+        m_records.clear();
+        m_nodes.assign(1, Node());
+    }
+
+    void IrradianceCache::clear() {
+        QWriteLocker guardLocker(&m_guard);
+        m_records.clear();
+        m_nodes.assign(1, Node());
+    }
+
+    std::vector<IrradianceCache::Record> IrradianceCache::records() const {
+        QReadLocker guardLocker(&m_guard);
+        return m_records;
+    }
+
+    void IrradianceCache::accumulate(Point3f const& position, Vector3f const& normal, Color& irradianceSum, float& weightSum) const {
+        QReadLocker guardLocker(&m_guard);
+        interpolate(0, m_center, m_halfSize, position, normal, irradianceSum, weightSum);
+    }
+
+    void IrradianceCache::insert(Point3f const& position, Vector3f const& normal, float radius, Color const& irradiance) {
+        QWriteLocker guardLocker(&m_guard);
+        Record record;
+        record.position = position;
+        record.normal = normal;
+        record.radius = radius;
+        record.irradiance = irradiance;
+        insert(record);
+    }
+
+    void IrradianceCache::insert(std::vector<Record> const& records) {
+        QWriteLocker guardLocker(&m_guard);
+        for (auto const& record : records) {
+            insert(record);
+        }
+    }
+
+    void IrradianceCache::insert(Record const& record) {
+        int recordIndex = m_records.size();
+        m_records.push_back(record);
+        float validDistance = m_maxError * record.radius;
+        int node = 0;
+        Point3f center = m_center;
+        float halfSize = m_halfSize;
+        if (looselyContains(center, halfSize, record.position)) {
+            for (int depth = 0; depth < MAX_DEPTH && halfSize / 2.0f >= validDistance; ++depth) {
+                int child = childIndex(center, record.position);
+                if (m_nodes[node].children[child] < 0) {
+                    int childNode = m_nodes.size();
+                    m_nodes.push_back(Node());
+                    m_nodes[node].children[child] = childNode;
+                }
+                node = m_nodes[node].children[child];
+                center = childCenter(center, halfSize, child);
+                halfSize /= 2.0f;
+            }
+        }
+        m_nodes[node].records.push_back(recordIndex);
+    }
+
+    void IrradianceCache::interpolate(int node, Point3f const& center, float halfSize, Point3f const& position, Vector3f const& normal, Color& irradianceSum, float& weightSum) const {
+        for (int recordIndex : m_nodes[node].records) {
+            Record const& record = m_records[recordIndex];
+            Vector3f offset = position - record.position;
+            if (dot(offset, normal + record.normal) < -0.01f * record.radius) {
+                continue;
+            }
+            float error = length(offset) / record.radius + sqrt(max(0.0f, 1.0f - dot(normal, record.normal)));
+            if (error >= m_maxError) {
+                continue;
+            }
+            float weight = 1.0f / max(error, 1e-4f) - 1.0f / m_maxError;
+            irradianceSum += record.irradiance * weight;
+            weightSum += weight;
+        }
+        for (int child = 0; child < 8; ++child) {
+            int childNode = m_nodes[node].children[child];
+            if (childNode < 0) {
+                continue;
+            }
+            Point3f childNodeCenter = childCenter(center, halfSize, child);
+            if (looselyContains(childNodeCenter, halfSize, position)) {
+                interpolate(childNode, childNodeCenter, halfSize / 2.0f, position, normal, irradianceSum, weightSum);
+            }
+        }
+    }
+}
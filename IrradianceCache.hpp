@@ -0,0 +1,61 @@
+#ifndef PHOTON_MAPPING_IRRADIANCE_CACHE_HPP
+#define PHOTON_MAPPING_IRRADIANCE_CACHE_HPP
+
+#include <vector>
+
+#include <QReadWriteLock>
+
+#include "Point.hpp"
+#include "Vector.hpp"
+#include "Segment.hpp"
+#include "Color.hpp"
+
+namespace photon_mapping {
+    class IrradianceCache {
+        public:
+            struct Record {
+                Point3f position;
+                Vector3f normal;
+                float radius;
+                Color irradiance;
+            };
+
+            IrradianceCache();
+
+            float maxError() const;
+            void setMaxError(float maxError);
+
+            void reset(Segment3f const& bound);
+            void reset(IrradianceCache const& cache);
+            void clear();
+
+            std::vector<Record> records() const;
+            void accumulate(Point3f const& position, Vector3f const& normal, Color& irradianceSum, float& weightSum) const;
+            void insert(Point3f const& position, Vector3f const& normal, float radius, Color const& irradiance);
+            void insert(std::vector<Record> const& records);
+
+        private:
+            struct Node {
+                int children[8];
+                std::vector<int> records;
+
+                Node();
+            };
+
+            static int const MAX_DEPTH = 24;
+
+            float m_maxError;
+            Point3f m_center;
+            float m_halfSize;
+            std::vector<Record> m_records;
+            std::vector<Node> m_nodes;
+            mutable QReadWriteLock m_guard;
+
+            void insert(Record const& record);
+            void interpolate(int node, Point3f const& center, float halfSize, Point3f const& position, Vector3f const& normal, Color& irradianceSum, float& weightSum) const;
+    };
+}
+
+#include "IrradianceCache.inl"
+
+#endif
@@ -0,0 +1,5 @@
+namespace photon_mapping {
+    inline float IrradianceCache::maxError() const {
+        return m_maxError;
+    }
+}
@@ -1,5 +1,7 @@
 #include "Label.hpp"
 
+#include <QPainter>
+
 namespace photon_mapping {
     Label::Label(QWidget* parent)
         : QLabel(parent)
@@ -26,6 +28,31 @@ namespace photon_mapping {
         return m_mousePosition;
     }
 
+    void Label::updateFramebuffer(QImage const& image, QRect const& dirtyRect) {
+        if (m_framebuffer.size() != image.size()) {
+            m_framebuffer = QPixmap::fromImage(image);
+            update();
+            return;
+        }
+        QPainter painter(&m_framebuffer);
+        painter.drawImage(dirtyRect.topLeft(), image, dirtyRect);
+        painter.end();
+        if (m_framebuffer.size() == size()) {
+            update(dirtyRect);
+        } else {
+            update();
+        }
+    }
+
+    void Label::paintEvent(QPaintEvent* event) {
+        if (m_framebuffer.isNull()) {
+            QLabel::paintEvent(event);
+            return;
+        }
+        QPainter painter(this);
+        painter.drawPixmap(rect(), m_framebuffer);
+    }
+
     void Label::resizeEvent(QResizeEvent* event) {
         emit resized(Extent2i(event->size().width(), event->size().height()));
         event->accept();
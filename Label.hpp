@@ -6,6 +6,10 @@
 #include <QLabel>
 #include <QKeyEvent>
 #include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPixmap>
+#include <QImage>
+#include <QRect>
 
 #include "Extent.hpp"
 #include "Point.hpp"
@@ -25,6 +29,8 @@ namespace photon_mapping {
             bool isMouseButtonPressed(Qt::MouseButton button) const;
             Point2i* mousePosition() const;
 
+            void updateFramebuffer(QImage const& image, QRect const& dirtyRect);
+
         signals:
             void resized(Extent2i const& extent);
             void keyPressed(Qt::Key key);
@@ -37,6 +43,7 @@ namespace photon_mapping {
             void mouseLeft();
 
         protected:
+            void paintEvent(QPaintEvent* event);
             void resizeEvent(QResizeEvent* event);
             void keyPressEvent(QKeyEvent* event);
             void keyReleaseEvent(QKeyEvent* event);
@@ -50,6 +57,7 @@ namespace photon_mapping {
             std::set<Qt::Key> m_keysPressed;
             std::set<Qt::MouseButton> m_mouseButtonsPressed;
             Point2i* m_mousePosition;
+            QPixmap m_framebuffer;
     };
 }
 
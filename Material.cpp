@@ -12,10 +12,21 @@ namespace photon_mapping {
         , m_normal(Texture<TextureType::NormalMap>::DUMMY)
         , m_refractionIndex(1.0f)
         , m_transmission(Color::BLACK)
+        , m_emissionIsUniform(true)
+        , m_uniformEmission(Color::BLACK)
+        , m_diffuseIsUniform(true)
+        , m_uniformDiffuse(Color::BLACK)
+        , m_specularIsUniform(true)
+        , m_uniformSpecular(Color::BLACK)
+        , m_normalIsFlat(true)
     {}
 
     void Material::setEmission(std::shared_ptr<Texture<TextureType::TrueColor> const> const& emission) {
         m_emission = emission;
+        m_emissionIsUniform = emission->isUniform();
+        if (m_emissionIsUniform) {
+            m_uniformEmission = emission->uniformValue();
+        }
     }
 
     void Material::setEmissionPower(float emissionPower) {
@@ -24,10 +35,18 @@ namespace photon_mapping {
 
     void Material::setDiffuse(std::shared_ptr<Texture<TextureType::TrueColor> const> const& diffuse) {
         m_diffuse = diffuse;
+        m_diffuseIsUniform = diffuse->isUniform();
+        if (m_diffuseIsUniform) {
+            m_uniformDiffuse = diffuse->uniformValue();
+        }
     }
 
     void Material::setSpecular(std::shared_ptr<Texture<TextureType::TrueColor> const> const& specular) {
         m_specular = specular;
+        m_specularIsUniform = specular->isUniform();
+        if (m_specularIsUniform) {
+            m_uniformSpecular = specular->uniformValue();
+        }
     }
 
     void Material::setSpecularPower(float specularPower) {
@@ -36,6 +55,10 @@ namespace photon_mapping {
 
     void Material::setNormal(std::shared_ptr<Texture<TextureType::NormalMap> const> const& normal) {
         m_normal = normal;
+        m_normalIsFlat = normal->isUniform()
+            && normal->uniformValue().x == Vector3f::UNIT_Z.x
+            && normal->uniformValue().y == Vector3f::UNIT_Z.y
+            && normal->uniformValue().z == Vector3f::UNIT_Z.z;
     }
 
     void Material::setRefractionIndex(float refractionIndex) {
@@ -4,6 +4,9 @@
 #include <memory>
 
 #include "Color.hpp"
+#include "Point.hpp"
+#include "Vector.hpp"
+#include "Matrix.hpp"
 #include "Texture.hpp"
 
 namespace photon_mapping {
@@ -37,6 +40,14 @@ namespace photon_mapping {
             Color const& transmission() const;
             void setTransmission(Color const& transmission);
 
+            bool isSpecular() const;
+            bool isEmissive() const;
+
+            Color emissionAt(Point2f const& texcoord) const;
+            Color diffuseAt(Point2f const& texcoord) const;
+            Color specularAt(Point2f const& texcoord) const;
+            Vector3f normalAt(Point2f const& texcoord, Vector3f const& tangent, Vector3f const& bitangent, Vector3f const& normal) const;
+
         private:    
             std::shared_ptr<Texture<TextureType::TrueColor> const> m_emission;
             float m_emissionPower;
@@ -46,6 +57,13 @@ namespace photon_mapping {
             std::shared_ptr<Texture<TextureType::NormalMap> const> m_normal;
             float m_refractionIndex;
             Color m_transmission;
+            bool m_emissionIsUniform;
+            Color m_uniformEmission;
+            bool m_diffuseIsUniform;
+            Color m_uniformDiffuse;
+            bool m_specularIsUniform;
+            Color m_uniformSpecular;
+            bool m_normalIsFlat;
     };
 }
 
@@ -30,4 +30,37 @@ namespace photon_mapping {
     inline Color const& Material::transmission() const {
         return m_transmission;
     }
+
+    inline bool Material::isSpecular() const {
+        return !m_specularIsUniform || luminance(m_uniformSpecular) > 0.0f || luminance(m_transmission) > 0.0f;
+    }
+
+    inline bool Material::isEmissive() const {
+        return m_emissionPower > 0.0f && (!m_emissionIsUniform || luminance(m_uniformEmission) > 0.0f);
+    }
+
+    inline Color Material::emissionAt(Point2f const& texcoord) const {
+        return m_emissionIsUniform ? m_uniformEmission : m_emission->fetch(texcoord);
+    }
+
+    inline Color Material::diffuseAt(Point2f const& texcoord) const {
+        return m_diffuseIsUniform ? m_uniformDiffuse : m_diffuse->fetch(texcoord);
+    }
+
+    inline Color Material::specularAt(Point2f const& texcoord) const {
+        return m_specularIsUniform ? m_uniformSpecular : m_specular->fetch(texcoord);
+    }
+
+    inline Vector3f Material::normalAt(Point2f const& texcoord, Vector3f const& tangent, Vector3f const& bitangent, Vector3f const& normal) const {
+        if (m_normalIsFlat) {
+            Vector3f tangentCrossBitangent = cross(tangent, bitangent);
+            return tangentCrossBitangent / dot(tangentCrossBitangent, normal);
+        }
+        return m_normal->fetch(texcoord) * ~Matrix43f(
+            tangent.x, bitangent.x, normal.x,
+            tangent.y, bitangent.y, normal.y,
+            tangent.z, bitangent.z, normal.z,
+                 0.0f,        0.0f,     0.0f
+        );
+    }
 }
\ No newline at end of file
@@ -2,5 +2,39 @@
 
 namespace photon_mapping {
     static std::vector<Mesh::Triangle> const noTriangles;
-    std::shared_ptr<Mesh const> const Mesh::DUMMY = std::make_shared<Mesh>(noTriangles.begin(), noTriangles.end());
-}
+    static std::vector<Mesh::TriangleAttributes> const noTriangleAttributes;
+    static std::vector<Mesh::Vertex> const noVertices;
+    std::shared_ptr<Mesh const> const Mesh::DUMMY = std::make_shared<Mesh>(noTriangles.begin(), noTriangles.end(), noTriangleAttributes.begin(), noVertices.begin(), noVertices.end());
+
+    Mesh::Mesh(std::vector<Triangle>& triangles, std::vector<TriangleAttributes>& triangleAttributes, std::vector<Vertex>& vertices)
+        : m_triangles(triangles)
+        , m_triangleAttributes(triangleAttributes)
+        , m_vertices(vertices)
+        , m_boundingIntervalHierarchy(m_triangles.begin(), m_triangles.end())
+    {
+        buildInclusiveCumulativeTriangleProbabilities();
+    }
+
+    Mesh::Mesh(Triangle const* triangles, TriangleAttributes const* triangleAttributes, float const* inclusiveCumulativeTriangleProbabilities, int triangleCount, Vertex const* vertices, int vertexCount, float area, Segment3f const& bound, TriangleBoundingIntervalHierarchy::Node const* boundingIntervalHierarchyNodes, int boundingIntervalHierarchyNodeCount, int const* boundingIntervalHierarchyPrimitiveIndices, std::shared_ptr<void const> const& storage)
+        : m_triangles(triangles, triangleCount, storage)
+        , m_triangleAttributes(triangleAttributes, triangleCount, storage)
+        , m_vertices(vertices, vertexCount, storage)
+        , m_area(area)
+        , m_inclusiveCumulativeTriangleProbabilities(inclusiveCumulativeTriangleProbabilities, triangleCount, storage)
+        , m_boundingIntervalHierarchy(triangles, bound, boundingIntervalHierarchyNodes, boundingIntervalHierarchyNodeCount, boundingIntervalHierarchyPrimitiveIndices, triangleCount, storage)
+    {}
+
+    void Mesh::buildInclusiveCumulativeTriangleProbabilities() {
+        m_area = 0.0f;
+        std::vector<float> inclusiveCumulativeTriangleProbabilities;
+        inclusiveCumulativeTriangleProbabilities.reserve(m_triangles.size());
+        for (auto& triangle : m_triangles) {
+            m_area += triangle.area();
+            inclusiveCumulativeTriangleProbabilities.push_back(m_area); 
+        }
+        for (auto& inclusiveCumulativeTriangleProbability : inclusiveCumulativeTriangleProbabilities) {
+            inclusiveCumulativeTriangleProbability /= m_area;
+        }
+        m_inclusiveCumulativeTriangleProbabilities.assign(inclusiveCumulativeTriangleProbabilities);
+    }
+}
\ No newline at end of file
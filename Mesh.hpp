@@ -3,12 +3,15 @@
 
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 #include "Point.hpp"
 #include "Vector.hpp"
 #include "Segment.hpp"
 #include "Random.hpp"
 #include "Ray.hpp"
+#include "Array.hpp"
+#include "packing.hpp"
 #include "BoundingIntervalHierarchy.hpp"
 
 namespace photon_mapping {
@@ -16,50 +19,95 @@ namespace photon_mapping {
         public:
             class Triangle {
                 public:
-                    struct Sample {
-                        Point3f position;
-                        Vector3f tangent;
-                        Vector3f bitangent;
-                        Vector3f normal;
-                        Point2f texcoord;
-                        int materialIndex;
+                    struct Hit {
+                        float wuv[3];
                     };
 
                     Point3f vertex; Vector3f edge01; Vector3f edge02;
-                    Vector3f tangents[3];
-                    Vector3f bitangents[3];
-                    Vector3f normals[3];
-                    Point2f texcoords[3];
-                    int materialIndex;
 
                     float area() const;
                     Segment3f bound() const;
-                    Sample uniformOnSurface(Random& random) const;
-                    bool hit(Ray const& ray, float& hitDistance, Sample& hit) const;
+                    bool hit(Ray const& ray, float& hitDistance, Hit& hit) const;
 
                 private:
                     bool hit(Ray const& ray, float& hitDistance, float (&hitWuv)[3]) const;
             };
 
-            struct Sample : Triangle::Sample {
-                std::vector<Triangle>::const_iterator triangle;
+            class Vertex {
+                public:
+                    Vertex();
+                    Vertex(Vector3f const& tangent, Vector3f const& bitangent, Vector3f const& normal, Point2f const& texcoord);
+
+                    Vector3f tangent() const;
+                    Vector3f bitangent() const;
+                    Vector3f normal() const;
+                    Point2f texcoord() const;
+
+                private:
+#ifdef PHOTON_MAPPING_COMPACT_VERTICES
+                    std::uint32_t m_packedTangent;
+                    std::uint32_t m_packedBitangent;
+                    std::uint32_t m_packedNormal;
+                    std::uint16_t m_packedTexcoord[2];
+#else
+                    Vector3f m_tangent;
+                    Vector3f m_bitangent;
+                    Vector3f m_normal;
+                    Point2f m_texcoord;
+#endif
+            };
+
+            struct TriangleAttributes {
+                int vertices[3];
+                int materialIndex;
+            };
+
+            typedef BoundingIntervalHierarchy<Triangle, Triangle const*> TriangleBoundingIntervalHierarchy;
+
+            struct Sample {
+                Point3f position;
+                Vector3f tangent;
+                Vector3f bitangent;
+                Vector3f normal;
+                Point2f texcoord;
+                int materialIndex;
+                Triangle const* triangle;
+            };
+
+            struct Hit : Triangle::Hit {
+                Triangle const* triangle;
             };
 
             static std::shared_ptr<Mesh const> const DUMMY;
 
-            template <typename TriangleForwardIterator>
-            Mesh(TriangleForwardIterator trianglesBegin, TriangleForwardIterator trianglesEnd);
-     
+            template <typename TriangleForwardIterator, typename TriangleAttributesForwardIterator, typename VertexForwardIterator>
+            Mesh(TriangleForwardIterator trianglesBegin, TriangleForwardIterator trianglesEnd, TriangleAttributesForwardIterator triangleAttributesBegin, VertexForwardIterator verticesBegin, VertexForwardIterator verticesEnd);
+            Mesh(std::vector<Triangle>& triangles, std::vector<TriangleAttributes>& triangleAttributes, std::vector<Vertex>& vertices);
+            Mesh(Triangle const* triangles, TriangleAttributes const* triangleAttributes, float const* inclusiveCumulativeTriangleProbabilities, int triangleCount, Vertex const* vertices, int vertexCount, float area, Segment3f const& bound, TriangleBoundingIntervalHierarchy::Node const* boundingIntervalHierarchyNodes, int boundingIntervalHierarchyNodeCount, int const* boundingIntervalHierarchyPrimitiveIndices, std::shared_ptr<void const> const& storage);
+
+            Array<Triangle> const& triangles() const;
+            Array<TriangleAttributes> const& triangleAttributes() const;
+            Array<Vertex> const& vertices() const;
+            Array<float> const& inclusiveCumulativeTriangleProbabilities() const;
+            TriangleBoundingIntervalHierarchy const& boundingIntervalHierarchy() const;
+
             float area() const;
             Segment3f bound() const;
             Sample uniformOnSurface(Random& random) const;
-            bool hit(Ray const& ray, float& hitDistance, Sample& hit) const;
+            Sample onTriangle(int triangleIndex, Point2f const& u) const;
+            bool hit(Ray const& ray, float& hitDistance, Hit& hit) const;
+            Sample shade(Ray const& ray, float hitDistance, Hit const& hit) const;
 
         private:
-            std::vector<Triangle> m_triangles;
+            Array<Triangle> m_triangles;
+            Array<TriangleAttributes> m_triangleAttributes;
+            Array<Vertex> m_vertices;
             float m_area;
-            std::vector<float> m_inclusiveCumulativeTriangleProbabilities;
-            BoundingIntervalHierarchy<Triangle, std::vector<Triangle>::const_iterator> m_boundingIntervalHierarchy;
+            Array<float> m_inclusiveCumulativeTriangleProbabilities;
+            TriangleBoundingIntervalHierarchy m_boundingIntervalHierarchy;
+
+            void buildInclusiveCumulativeTriangleProbabilities();
+            void cornerAttributes(TriangleAttributes const& triangleAttributes, Vector3f (&tangents)[3], Vector3f (&bitangents)[3], Vector3f (&normals)[3], Point2f (&texcoords)[3]) const;
     };
 }
 
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <iterator>
 
 namespace photon_mapping {
     inline float Mesh::Triangle::area() const {
@@ -9,41 +10,12 @@ namespace photon_mapping {
         return Segment3f(vertex) | Segment3f(vertex + edge01) | Segment3f(vertex + edge02);
     }
 
-    inline Mesh::Triangle::Sample Mesh::Triangle::uniformOnSurface(Random& random) const {
-        float vuw[3];
-        vuw[1] = random.uniformInRange01();
-        vuw[2] = random.uniformInRange01();
-        vuw[0] = 1.0f - (vuw[1] + vuw[2]);
-        if (vuw[0] < 0.0f) {
-            vuw[0] = -vuw[0];
-            vuw[1] = 1.0f - vuw[1];
-            vuw[2] = 1.0f - vuw[2];
-        }
-        Sample sample;
-        sample.position = vertex + edge01 * vuw[1] + edge02 * vuw[2];
-        sample.tangent = unit(avg(tangents, vuw));
-        sample.bitangent = unit(avg(bitangents, vuw));
-        sample.normal = unit(avg(normals, vuw));
-        sample.texcoord = avg(texcoords, vuw);
-        sample.materialIndex = materialIndex;
-        return sample;
-    }
-
-    inline bool Mesh::Triangle::hit(Ray const& ray, float& hitDistance, Sample& hit) const {
-        float hitWuv[3];
-        if (this->hit(ray, hitDistance, hitWuv)) {
-            hit.position = ray.origin + ray.direction * hitDistance;
-            hit.tangent = avg(tangents, hitWuv);
-            hit.bitangent = avg(bitangents, hitWuv);
-            hit.normal = avg(normals, hitWuv);
-            hit.texcoord = avg(texcoords, hitWuv);
-            hit.materialIndex = materialIndex;
-            return true;
-        }
-        return false;
+    inline bool Mesh::Triangle::hit(Ray const& ray, float& hitDistance, Hit& hit) const {
+        return this->hit(ray, hitDistance, hit.wuv);
     }
 
     inline bool Mesh::Triangle::hit(Ray const& ray, float& hitDistance, float (&hitWuv)[3]) const {
+        PHOTON_MAPPING_COUNT(trianglesTested, 1);
         Vector3f k = ray.origin - vertex;
         Vector3f p = cross(ray.direction, edge02);
         Vector3f q = cross(k, edge01);
@@ -55,20 +27,86 @@ namespace photon_mapping {
         return (0.0f < hitDistance) & (0.0f <= hitWuv[0]) & (0.0f <= hitWuv[1]) & (0.0f <= hitWuv[2]);
     }
 
-    template <typename TriangleForwardIterator>
-    Mesh::Mesh(TriangleForwardIterator trianglesBegin, TriangleForwardIterator trianglesEnd)
+    inline Mesh::Vertex::Vertex() {}
+
+#ifdef PHOTON_MAPPING_COMPACT_VERTICES
+    inline Mesh::Vertex::Vertex(Vector3f const& tangent, Vector3f const& bitangent, Vector3f const& normal, Point2f const& texcoord)
+        : m_packedTangent(packOctahedral(tangent))
+        , m_packedBitangent(packOctahedral(bitangent))
+        , m_packedNormal(packOctahedral(normal))
+    {
+        m_packedTexcoord[0] = packHalf(texcoord.x);
+        m_packedTexcoord[1] = packHalf(texcoord.y);
+    }
+
+    inline Vector3f Mesh::Vertex::tangent() const {
+        return unpackOctahedral(m_packedTangent);
+    }
+
+    inline Vector3f Mesh::Vertex::bitangent() const {
+        return unpackOctahedral(m_packedBitangent);
+    }
+
+    inline Vector3f Mesh::Vertex::normal() const {
+        return unpackOctahedral(m_packedNormal);
+    }
+
+    inline Point2f Mesh::Vertex::texcoord() const {
+        return Point2f(unpackHalf(m_packedTexcoord[0]), unpackHalf(m_packedTexcoord[1]));
+    }
+#else
+    inline Mesh::Vertex::Vertex(Vector3f const& tangent, Vector3f const& bitangent, Vector3f const& normal, Point2f const& texcoord)
+        : m_tangent(tangent)
+        , m_bitangent(bitangent)
+        , m_normal(normal)
+        , m_texcoord(texcoord)
+    {}
+
+    inline Vector3f Mesh::Vertex::tangent() const {
+        return m_tangent;
+    }
+
+    inline Vector3f Mesh::Vertex::bitangent() const {
+        return m_bitangent;
+    }
+
+    inline Vector3f Mesh::Vertex::normal() const {
+        return m_normal;
+    }
+
+    inline Point2f Mesh::Vertex::texcoord() const {
+        return m_texcoord;
+    }
+#endif
+
+    template <typename TriangleForwardIterator, typename TriangleAttributesForwardIterator, typename VertexForwardIterator>
+    Mesh::Mesh(TriangleForwardIterator trianglesBegin, TriangleForwardIterator trianglesEnd, TriangleAttributesForwardIterator triangleAttributesBegin, VertexForwardIterator verticesBegin, VertexForwardIterator verticesEnd)
         : m_triangles(trianglesBegin, trianglesEnd)
-        , m_inclusiveCumulativeTriangleProbabilities(0)
+        , m_triangleAttributes(triangleAttributesBegin, std::next(triangleAttributesBegin, std::distance(trianglesBegin, trianglesEnd)))
+        , m_vertices(verticesBegin, verticesEnd)
         , m_boundingIntervalHierarchy(m_triangles.begin(), m_triangles.end())
     {
-        m_area = 0.0f;
-        for (auto& triangle : m_triangles) {
-            m_area += triangle.area();
-            m_inclusiveCumulativeTriangleProbabilities.push_back(m_area); 
-        }
-        for (auto& inclusiveCumulativeTriangleProbability : m_inclusiveCumulativeTriangleProbabilities) {
-            inclusiveCumulativeTriangleProbability /= m_area;
-        }
+        buildInclusiveCumulativeTriangleProbabilities();
+    }
+
+    inline Array<Mesh::Triangle> const& Mesh::triangles() const {
+        return m_triangles;
+    }
+
+    inline Array<Mesh::TriangleAttributes> const& Mesh::triangleAttributes() const {
+        return m_triangleAttributes;
+    }
+
+    inline Array<Mesh::Vertex> const& Mesh::vertices() const {
+        return m_vertices;
+    }
+
+    inline Array<float> const& Mesh::inclusiveCumulativeTriangleProbabilities() const {
+        return m_inclusiveCumulativeTriangleProbabilities;
+    }
+
+    inline Mesh::TriangleBoundingIntervalHierarchy const& Mesh::boundingIntervalHierarchy() const {
+        return m_boundingIntervalHierarchy;
     }
 
     inline float Mesh::area() const {
@@ -81,14 +119,63 @@ namespace photon_mapping {
 
     inline Mesh::Sample Mesh::uniformOnSurface(Random& random) const {
         int triangleIndex = std::lower_bound(m_inclusiveCumulativeTriangleProbabilities.begin(), m_inclusiveCumulativeTriangleProbabilities.end(), random.uniformInRange01()) - m_inclusiveCumulativeTriangleProbabilities.begin();
-        auto triangle = m_triangles.begin() + triangleIndex;  
+        Point2f u;
+        u.x = random.uniformInRange01();
+        u.y = random.uniformInRange01();
+        return onTriangle(triangleIndex, u);
+    }
+
+    inline Mesh::Sample Mesh::onTriangle(int triangleIndex, Point2f const& u) const {
+        Triangle const& triangle = m_triangles[triangleIndex];
+        TriangleAttributes const& triangleAttributes = m_triangleAttributes[triangleIndex];
+        float vuw[3];
+        vuw[1] = u.x;
+        vuw[2] = u.y;
+        vuw[0] = 1.0f - (vuw[1] + vuw[2]);
+        if (vuw[0] < 0.0f) {
+            vuw[0] = -vuw[0];
+            vuw[1] = 1.0f - vuw[1];
+            vuw[2] = 1.0f - vuw[2];
+        }
+        Vector3f tangents[3]; Vector3f bitangents[3]; Vector3f normals[3]; Point2f texcoords[3];
+        cornerAttributes(triangleAttributes, tangents, bitangents, normals, texcoords);
         Sample sample;
-        static_cast<Triangle::Sample&>(sample) = triangle->uniformOnSurface(random);
-        sample.triangle = triangle;
+        sample.position = triangle.vertex + triangle.edge01 * vuw[1] + triangle.edge02 * vuw[2];
+        sample.tangent = unit(avg(tangents, vuw));
+        sample.bitangent = unit(avg(bitangents, vuw));
+        sample.normal = unit(avg(normals, vuw));
+        sample.texcoord = avg(texcoords, vuw);
+        sample.materialIndex = triangleAttributes.materialIndex;
+        sample.triangle = &triangle;
         return sample;
     }
 
-    inline bool Mesh::hit(Ray const& ray, float& hitDistance, Sample& hit) const {
+    inline bool Mesh::hit(Ray const& ray, float& hitDistance, Hit& hit) const {
         return m_boundingIntervalHierarchy.hit(ray, hitDistance, hit, hit.triangle);
     }
+
+    inline Mesh::Sample Mesh::shade(Ray const& ray, float hitDistance, Hit const& hit) const {
+        TriangleAttributes const& triangleAttributes = m_triangleAttributes[hit.triangle - m_triangles.begin()];
+        Vector3f tangents[3]; Vector3f bitangents[3]; Vector3f normals[3]; Point2f texcoords[3];
+        cornerAttributes(triangleAttributes, tangents, bitangents, normals, texcoords);
+        Sample sample;
+        sample.position = ray.origin + ray.direction * hitDistance;
+        sample.tangent = avg(tangents, hit.wuv);
+        sample.bitangent = avg(bitangents, hit.wuv);
+        sample.normal = avg(normals, hit.wuv);
+        sample.texcoord = avg(texcoords, hit.wuv);
+        sample.materialIndex = triangleAttributes.materialIndex;
+        sample.triangle = hit.triangle;
+        return sample;
+    }
+
+    inline void Mesh::cornerAttributes(TriangleAttributes const& triangleAttributes, Vector3f (&tangents)[3], Vector3f (&bitangents)[3], Vector3f (&normals)[3], Point2f (&texcoords)[3]) const {
+        for (int i = 0; i < 3; ++i) {
+            Vertex const& vertex = m_vertices[triangleAttributes.vertices[i]];
+            tangents[i] = vertex.tangent();
+            bitangents[i] = vertex.bitangent();
+            normals[i] = vertex.normal();
+            texcoords[i] = vertex.texcoord();
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "MicrobenchmarkApplication.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <QDir>
+#include <QElapsedTimer>
+
+#include "Random.hpp"
+#include "Ray.hpp"
+#include "Segment.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+#include "Photon.hpp"
+#include "PhotonMap.hpp"
+#include "Texture.hpp"
+#include "loadObj.hpp"
+
+namespace photon_mapping {
+    namespace {
+        int const RAY_COUNT = 1 << 12;
+
+        std::vector<Ray> uniformRays(Random& random, int rayCount) {
+            std::vector<Ray> rays(rayCount);
+            for (auto& ray : rays) {
+                ray.origin = Point3f(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+                ray.direction = random.uniformDirection();
+            }
+            return rays;
+        }
+
+        std::vector<Mesh::Triangle> uniformTriangles(Random& random, int triangleCount, float triangleSize) {
+            std::vector<Mesh::Triangle> triangles(triangleCount);
+            for (auto& triangle : triangles) {
+                triangle.vertex = Point3f(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+                triangle.edge01 = random.uniformDirection() * triangleSize;
+                triangle.edge02 = random.uniformDirection() * triangleSize;
+            }
+            return triangles;
+        }
+
+        std::vector<Mesh::TriangleAttributes> flatTriangleAttributes(std::vector<Mesh::Triangle> const& triangles, std::vector<Mesh::Vertex>& vertices) {
+            std::vector<Mesh::TriangleAttributes> triangleAttributes(triangles.size());
+            for (int i = 0; i < int(triangles.size()); ++i) {
+                Vector3f normal = unit(cross(triangles[i].edge01, triangles[i].edge02));
+                Vector3f tangent = unit(triangles[i].edge01);
+                for (int j = 0; j < 3; ++j) {
+                    triangleAttributes[i].vertices[j] = vertices.size();
+                }
+                triangleAttributes[i].materialIndex = 0;
+                vertices.push_back(Mesh::Vertex(tangent, cross(normal, tangent), normal, Point2f(0.0f, 0.0f)));
+            }
+            return triangleAttributes;
+        }
+    }
+
+    MicrobenchmarkApplication::MicrobenchmarkApplication(int& argc, char** argv)
+        : QCoreApplication(argc, argv)
+        , m_modelDirectoryPath("models")
+        , m_minNsecs(500000000)
+        , m_out(stdout)
+        , m_sink(0.0f)
+    {
+        QStringList paths = libraryPaths();
+        paths.append(".");
+        paths.append("imageformats");
+        setLibraryPaths(paths);
+    }
+
+    int MicrobenchmarkApplication::run() {
+        if (!parseArguments()) {
+            printUsage();
+            return 1;
+        }
+
+        m_out << QString("%1 %2 %3 %4\n")
+            .arg("benchmark", -48)
+            .arg("ops", 12)
+            .arg("ns/op", 10)
+            .arg("Mops/s", 10);
+        benchmarkSegments();
+        benchmarkTriangles();
+        benchmarkBoundingIntervalHierarchy();
+        benchmarkPhotonMap();
+        benchmarkTextures();
+        m_out.flush();
+
+        QTextStream(stderr) << "sink " << m_sink << "\n";
+        return 0;
+    }
+
+    template <typename Kernel>
+    void MicrobenchmarkApplication::measure(QString const& name, Kernel kernel) {
+        if (!m_filter.isEmpty() && !name.contains(m_filter)) {
+            return;
+        }
+        qint64 opCount = 1;
+        qint64 nsecs = 0;
+        while (true) {
+            QElapsedTimer timer;
+            timer.start();
+            m_sink += kernel(opCount);
+            nsecs = timer.nsecsElapsed();
+            if (nsecs >= m_minNsecs) {
+                break;
+            }
+            opCount *= 2;
+        }
+        double nsecsPerOp = double(nsecs) / opCount;
+        m_out << QString("%1 %2 %3 %4\n")
+            .arg(name, -48)
+            .arg(opCount, 12)
+            .arg(nsecsPerOp, 10, 'f', 2)
+            .arg(1e3 / nsecsPerOp, 10, 'f', 2);
+        m_out.flush();
+    }
+
+    void MicrobenchmarkApplication::benchmarkSegments() {
+        Random random(1);
+        std::vector<Ray> rays = uniformRays(random, RAY_COUNT);
+        std::vector<Segment3f> segments(RAY_COUNT);
+        for (auto& segment : segments) {
+            Point3f a(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+            Point3f b(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+            segment = Segment3f(a) | Segment3f(b);
+        }
+        measure("Segment3f::hit", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                float minDistance, maxDistance;
+                if (segments[op % RAY_COUNT].hit(rays[(op / RAY_COUNT + op) % RAY_COUNT], minDistance, maxDistance)) {
+                    sink += minDistance;
+                }
+            }
+            return sink;
+        });
+    }
+
+    void MicrobenchmarkApplication::benchmarkTriangles() {
+        Random random(2);
+        std::vector<Ray> rays = uniformRays(random, RAY_COUNT);
+        std::vector<Mesh::Triangle> triangles = uniformTriangles(random, RAY_COUNT, 1.0f);
+        measure("Mesh::Triangle::hit", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                float hitDistance; Mesh::Triangle::Hit hit;
+                if (triangles[op % RAY_COUNT].hit(rays[(op / RAY_COUNT + op) % RAY_COUNT], hitDistance, hit)) {
+                    sink += hitDistance;
+                }
+            }
+            return sink;
+        });
+    }
+
+    void MicrobenchmarkApplication::benchmarkBoundingIntervalHierarchy() {
+        Random random(3);
+        std::vector<Ray> rays = uniformRays(random, RAY_COUNT);
+        for (int triangleCount = 1000; triangleCount <= 1000000; triangleCount *= 10) {
+            std::vector<Mesh::Triangle> triangles = uniformTriangles(random, triangleCount, 2.0f / pow(triangleCount, 1.0f / 3.0f));
+            std::vector<Mesh::Vertex> vertices;
+            std::vector<Mesh::TriangleAttributes> triangleAttributes = flatTriangleAttributes(triangles, vertices);
+            Mesh mesh(triangles.begin(), triangles.end(), triangleAttributes.begin(), vertices.begin(), vertices.end());
+            measure(QString("BoundingIntervalHierarchy::hit synthetic %1").arg(triangleCount), [&](qint64 opCount) {
+                float sink = 0.0f;
+                for (qint64 op = 0; op < opCount; ++op) {
+                    float hitDistance; Mesh::Hit hit;
+                    if (mesh.hit(rays[op % RAY_COUNT], hitDistance, hit)) {
+                        sink += hitDistance;
+                    }
+                }
+                return sink;
+            });
+        }
+
+        QStringList modelNames;
+        modelNames << "CornellBox-Original" << "CornellBox-Sphere" << "CornellBox-Water";
+        for (auto const& modelName : modelNames) {
+            auto scene = std::make_shared<Scene>();
+            loadObj(scene, QDir(m_modelDirectoryPath).filePath(modelName + ".obj"));
+            if (scene->empty()) {
+                QTextStream(stderr) << "failed to load " << modelName << "\n";
+                continue;
+            }
+            scene->invalidate();
+            std::vector<Ray> sceneRays(RAY_COUNT);
+            for (auto& ray : sceneRays) {
+                Scene::Sample sample = scene->uniformOnSurface(random);
+                ray.direction = random.cosineDirection(sample.normal);
+                ray.origin = sample.position + ray.direction * 0.001f;
+            }
+            measure(QString("BoundingIntervalHierarchy::hit %1").arg(modelName), [&](qint64 opCount) {
+                float sink = 0.0f;
+                for (qint64 op = 0; op < opCount; ++op) {
+                    float hitDistance; Scene::Hit hit;
+                    if (scene->hit(sceneRays[op % RAY_COUNT], hitDistance, hit)) {
+                        sink += hitDistance;
+                    }
+                }
+                return sink;
+            });
+        }
+    }
+
+    void MicrobenchmarkApplication::benchmarkPhotonMap() {
+        Random random(4);
+        std::vector<Point3f> positions(RAY_COUNT);
+        for (auto& position : positions) {
+            position = Point3f(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+        }
+        for (int photonCount = 10000; photonCount <= 1000000; photonCount *= 10) {
+            std::vector<Photon> photons(photonCount);
+            for (auto& photon : photons) {
+                Point3f position(random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f), random.uniformInRange(-1.0f, 1.0f));
+                photon = Photon(position, random.uniformDirection(), Color::WHITE);
+            }
+            PhotonMap photonMap(photons);
+            for (int level = 0; level < photonMap.levelCount(); ++level) {
+                for (int subtree = 0; subtree < PhotonMap::subtreeCountAtLevel(level); ++subtree) {
+                    photonMap.buildLevelOnSubtree(level, subtree);
+                }
+            }
+            int const nearestPhotonCounts[] = {10, 50, 100, 500};
+            for (int nearestPhotonCount : nearestPhotonCounts) {
+                std::vector<PhotonMap::NearestPhoton> nearestPhotons(nearestPhotonCount);
+                measure(QString("PhotonMap::nearest N=%1 k=%2").arg(photonCount).arg(nearestPhotonCount), [&](qint64 opCount) {
+                    float sink = 0.0f;
+                    for (qint64 op = 0; op < opCount; ++op) {
+                        photonMap.nearest(positions[op % RAY_COUNT], nearestPhotons.begin(), nearestPhotons.end());
+                        sink += nearestPhotons.front().sqrDistance;
+                    }
+                    return sink;
+                });
+            }
+        }
+    }
+
+    void MicrobenchmarkApplication::benchmarkTextures() {
+        Random random(5);
+        std::vector<Point2f> texcoords(RAY_COUNT);
+        for (auto& texcoord : texcoords) {
+            texcoord = Point2f(random.uniformInRange01(), random.uniformInRange01());
+        }
+        QString texturePath = QDir(m_modelDirectoryPath).filePath("CornellBox-Mapping/diffuse.png");
+        Texture<TextureType::TrueColor> uniformTrueColorTexture(Color::WHITE);
+        Texture<TextureType::TrueColor> trueColorTexture(texturePath);
+        Texture<TextureType::GrayScale> grayScaleTexture(texturePath);
+        Texture<TextureType::NormalMap> normalMapTexture(texturePath);
+        measure("Texture<TrueColor>::fetch uniform", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                sink += uniformTrueColorTexture.fetch(texcoords[op % RAY_COUNT]).r;
+            }
+            return sink;
+        });
+        measure("Texture<TrueColor>::fetch diffuse.png", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                sink += trueColorTexture.fetch(texcoords[op % RAY_COUNT]).r;
+            }
+            return sink;
+        });
+        measure("Texture<GrayScale>::fetch diffuse.png", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                sink += grayScaleTexture.fetch(texcoords[op % RAY_COUNT]);
+            }
+            return sink;
+        });
+        measure("Texture<NormalMap>::fetch diffuse.png", [&](qint64 opCount) {
+            float sink = 0.0f;
+            for (qint64 op = 0; op < opCount; ++op) {
+                sink += normalMapTexture.fetch(texcoords[op % RAY_COUNT]).z;
+            }
+            return sink;
+        });
+    }
+
+    bool MicrobenchmarkApplication::parseArguments() {
+        QStringList args = arguments();
+        for (int i = 1; i < args.length(); ++i) {
+            QString const& arg = args[i];
+            if (i + 1 == args.length()) {
+                return false;
+            }
+            QString const& value = args[++i];
+            bool ok = true;
+            if (arg == "--models") {
+                m_modelDirectoryPath = value;
+            } else if (arg == "--filter") {
+                m_filter = value;
+            } else if (arg == "--min-time") {
+                m_minNsecs = value.toDouble(&ok) * 1e9;
+                ok = ok && m_minNsecs > 0;
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void MicrobenchmarkApplication::printUsage() const {
+        QTextStream err(stderr);
+        err << "usage: " << arguments()[0] << " [options]\n"
+            << "  --models DIR            directory with the Cornell box models (models)\n"
+            << "  --filter TEXT           run only benchmarks whose name contains TEXT\n"
+            << "  --min-time SECONDS      minimal measured time per benchmark (0.5)\n";
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PHOTON_MAPPING_MICROBENCHMARK_APPLICATION_HPP
+#define PHOTON_MAPPING_MICROBENCHMARK_APPLICATION_HPP
+
+#include <QCoreApplication>
+#include <QString>
+#include <QTextStream>
+
+namespace photon_mapping {
+    class MicrobenchmarkApplication
+        : public QCoreApplication
+    {
+        public:
+            MicrobenchmarkApplication(int& argc, char** argv);
+
+            int run();
+
+        private:
+            QString m_modelDirectoryPath;
+            QString m_filter;
+            qint64 m_minNsecs;
+            QTextStream m_out;
+            float m_sink;
+
+            bool parseArguments();
+            void printUsage() const;
+
+            template <typename Kernel>
+            void measure(QString const& name, Kernel kernel);
+
+            void benchmarkSegments();
+            void benchmarkTriangles();
+            void benchmarkBoundingIntervalHierarchy();
+            void benchmarkPhotonMap();
+            void benchmarkTextures();
+    };
+}
+
+#endif
@@ -24,7 +24,11 @@ namespace photon_mapping {
                 Vector3f normal;
                 float refractionIndex;
                 Color transmission;
-                std::vector<Mesh::Triangle>::const_iterator triangle;
+                Mesh::Triangle const* triangle;
+            };
+
+            struct Hit : Mesh::Hit {
+                float meshHitDistance;
             };
 
             Object();
@@ -43,13 +47,16 @@ namespace photon_mapping {
             std::shared_ptr<Mesh const> const& mesh() const;
             void setMesh(std::shared_ptr<Mesh const> const& mesh);
 
+            int materialCount() const;
             std::shared_ptr<Material const> const& material(int index) const;
             void setMaterial(int index, std::shared_ptr<Material const> const& material);
 
             float area() const;
             Segment3f bound() const;
             Sample uniformOnSurface(Random& random) const;
-            bool hit(Ray const& ray, float& hitDistance, Sample& hit) const;
+            Sample onTriangle(int triangleIndex, Point2f const& u) const;
+            bool hit(Ray const& ray, float& hitDistance, Hit& hit) const;
+            Sample shade(Ray const& ray, Hit const& hit) const;
 
         private:    
             QString m_name;
@@ -59,6 +66,8 @@ namespace photon_mapping {
 
             std::shared_ptr<Mesh const> m_mesh;
             std::vector<std::shared_ptr<Material const>> m_materials;
+
+            Sample surfaceSample(Mesh::Sample const& meshSample) const;
     };
 }
 
@@ -15,6 +15,10 @@ namespace photon_mapping {
         return m_mesh;
     }
 
+    inline int Object::materialCount() const {
+        return m_materials.size();
+    }
+
     inline std::shared_ptr<Material const> const& Object::material(int index) const {
         if (0 <= index && index < m_materials.size()) {
             return m_materials[index];
@@ -32,47 +36,52 @@ namespace photon_mapping {
     }
 
     inline Object::Sample Object::uniformOnSurface(Random& random) const {
-        Mesh::Sample meshSample = mesh()->uniformOnSurface(random);
+        return surfaceSample(mesh()->uniformOnSurface(random));
+    }
+
+    inline Object::Sample Object::onTriangle(int triangleIndex, Point2f const& u) const {
+        return surfaceSample(mesh()->onTriangle(triangleIndex, u));
+    }
+
+    inline Object::Sample Object::surfaceSample(Mesh::Sample const& meshSample) const {
+        Material const& sampleMaterial = *material(meshSample.materialIndex);
         Sample sample;
         sample.position = meshSample.position * transformation();
-        sample.emission = material(meshSample.materialIndex)->emission()->fetch(meshSample.texcoord); 
-        sample.emissionPower = material(meshSample.materialIndex)->emissionPower();
-        sample.diffuse = material(meshSample.materialIndex)->diffuse()->fetch(meshSample.texcoord);
-        sample.specular = material(meshSample.materialIndex)->specular()->fetch(meshSample.texcoord);
-        sample.specularPower = material(meshSample.materialIndex)->specularPower();
-        sample.normal = material(meshSample.materialIndex)->normal()->fetch(meshSample.texcoord) * ~Matrix43f(
-            meshSample.tangent.x, meshSample.bitangent.x, meshSample.normal.x,
-            meshSample.tangent.y, meshSample.bitangent.y, meshSample.normal.y,
-            meshSample.tangent.z, meshSample.bitangent.z, meshSample.normal.z,
-                            0.0f,                0.0f,             0.0f
-        ) * transformation();
-        sample.refractionIndex = material(meshSample.materialIndex)->refractionIndex();
-        sample.transmission = material(meshSample.materialIndex)->transmission();
+        sample.emission = sampleMaterial.emissionAt(meshSample.texcoord);
+        sample.emissionPower = sampleMaterial.emissionPower();
+        sample.diffuse = sampleMaterial.diffuseAt(meshSample.texcoord);
+        sample.specular = sampleMaterial.specularAt(meshSample.texcoord);
+        sample.specularPower = sampleMaterial.specularPower();
+        sample.normal = sampleMaterial.normalAt(meshSample.texcoord, meshSample.tangent, meshSample.bitangent, meshSample.normal) * transformation();
+        sample.refractionIndex = sampleMaterial.refractionIndex();
+        sample.transmission = sampleMaterial.transmission();
         sample.triangle = meshSample.triangle;
         return sample;
     }
 
-    inline bool Object::hit(Ray const& ray, float& hitDistance, Sample& hit) const{
-        float meshHitDistance; Mesh::Sample meshHit;
-        if (mesh()->hit(ray * inverseTransformation(), meshHitDistance, meshHit)) {
-            hit.position = meshHit.position * transformation();
-            hit.emission = material(meshHit.materialIndex)->emission()->fetch(meshHit.texcoord);
-            hit.emissionPower = material(meshHit.materialIndex)->emissionPower();
-            hit.diffuse = material(meshHit.materialIndex)->diffuse()->fetch(meshHit.texcoord);
-            hit.specular = material(meshHit.materialIndex)->specular()->fetch(meshHit.texcoord);
-            hit.specularPower = material(meshHit.materialIndex)->specularPower();
-            hit.normal = material(meshHit.materialIndex)->normal()->fetch(meshHit.texcoord) * ~Matrix43f(
-                meshHit.tangent.x, meshHit.bitangent.x, meshHit.normal.x,
-                meshHit.tangent.y, meshHit.bitangent.y, meshHit.normal.y,
-                meshHit.tangent.z, meshHit.bitangent.z, meshHit.normal.z,
-                             0.0f,                0.0f,             0.0f
-            ) * transformation();
-            hit.refractionIndex = material(meshHit.materialIndex)->refractionIndex();
-            hit.transmission = material(meshHit.materialIndex)->transmission();
-            hit.triangle = meshHit.triangle;
-            hitDistance = distance(hit.position, ray.origin);
+    inline bool Object::hit(Ray const& ray, float& hitDistance, Hit& hit) const{
+        Ray meshRay = ray * inverseTransformation();
+        if (mesh()->hit(meshRay, hit.meshHitDistance, hit)) {
+            hitDistance = distance((meshRay.origin + meshRay.direction * hit.meshHitDistance) * transformation(), ray.origin);
             return true;
         }
         return false;
     }
+
+    inline Object::Sample Object::shade(Ray const& ray, Hit const& hit) const {
+        Mesh::Sample meshHit = mesh()->shade(ray * inverseTransformation(), hit.meshHitDistance, hit);
+        Material const& hitMaterial = *material(meshHit.materialIndex);
+        Sample sample;
+        sample.position = meshHit.position * transformation();
+        sample.emission = hitMaterial.emissionAt(meshHit.texcoord);
+        sample.emissionPower = hitMaterial.emissionPower();
+        sample.diffuse = hitMaterial.diffuseAt(meshHit.texcoord);
+        sample.specular = hitMaterial.specularAt(meshHit.texcoord);
+        sample.specularPower = hitMaterial.specularPower();
+        sample.normal = hitMaterial.normalAt(meshHit.texcoord, meshHit.tangent, meshHit.bitangent, meshHit.normal) * transformation();
+        sample.refractionIndex = hitMaterial.refractionIndex();
+        sample.transmission = hitMaterial.transmission();
+        sample.triangle = meshHit.triangle;
+        return sample;
+    }
 }
\ No newline at end of file
@@ -1,16 +1,34 @@
 #ifndef PHOTON_MAPPING_PHOTON_HPP
 #define PHOTON_MAPPING_PHOTON_HPP
 
+#include <cstdint>
+
 #include "Point.hpp"
 #include "Vector.hpp"
 #include "Color.hpp"
 
 namespace photon_mapping {
-    struct Photon {
-        Point3f position;
-        Vector3f direction;
-        Color power;
+    class Photon {
+        public:
+            Photon();
+            Photon(Point3f const& position, Vector3f const& direction, Color const& power);
+
+            Point3f const& position() const;
+            Vector3f direction() const;
+            Color power() const;
+
+        private:
+            Point3f m_position;
+#ifdef PHOTON_MAPPING_COMPACT_PHOTONS
+            std::uint32_t m_packedPower;
+            std::uint16_t m_packedDirection;
+#else
+            Vector3f m_direction;
+            Color m_power;
+#endif
     };
 }
 
+#include "Photon.inl"
+
 #endif
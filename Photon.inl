@@ -0,0 +1,39 @@
+#include "packing.hpp"
+
+namespace photon_mapping {
+    inline Photon::Photon() {}
+
+    inline Point3f const& Photon::position() const {
+        return m_position;
+    }
+
+#ifdef PHOTON_MAPPING_COMPACT_PHOTONS
+    inline Photon::Photon(Point3f const& position, Vector3f const& direction, Color const& power)
+        : m_position(position)
+        , m_packedPower(packRgbe(power))
+        , m_packedDirection(packOctahedral16(direction))
+    {}
+
+    inline Vector3f Photon::direction() const {
+        return unpackOctahedral16(m_packedDirection);
+    }
+
+    inline Color Photon::power() const {
+        return unpackRgbe(m_packedPower);
+    }
+#else
+    inline Photon::Photon(Point3f const& position, Vector3f const& direction, Color const& power)
+        : m_position(position)
+        , m_direction(direction)
+        , m_power(power)
+    {}
+
+    inline Vector3f Photon::direction() const {
+        return m_direction;
+    }
+
+    inline Color Photon::power() const {
+        return m_power;
+    }
+#endif
+}
@@ -6,6 +6,7 @@
 
 #include "Photon.hpp"
 #include "Segment.hpp"
+#include "Counters.hpp"
 
 #include <QDebug>
 
@@ -29,7 +30,7 @@ namespace photon_mapping {
                 if (level == 0) {
                     m_photonsBound = Segment3f::NOTHING;
                     for (auto& photon : m_photons) {
-                        m_photonsBound |= Segment3f(photon.position);
+                        m_photonsBound |= Segment3f(photon.position());
                     }
                 }
                 buildLevelOnSubtree(level, subtree, m_photons.begin(), m_photons.end(), m_photonsBound);
@@ -40,8 +41,9 @@ namespace photon_mapping {
                 float sqrDistance;
             };
 
-            std::vector<NearestPhoton>::iterator nearest(Point3f const& position, std::vector<NearestPhoton>::iterator nearestBegin, std::vector<NearestPhoton>::iterator nearestEnd) const {
-                return nearest(m_photons.begin(), m_photons.end(), m_photonsBound, position, nearestBegin, nearestBegin, nearestEnd);
+            std::vector<NearestPhoton>::iterator nearest(Point3f const& position, std::vector<NearestPhoton>::iterator nearestBegin, std::vector<NearestPhoton>::iterator nearestEnd, float maxDistance = inf()) const {
+                PHOTON_MAPPING_COUNT(photonGathers, 1);
+                return nearest(m_photons.begin(), m_photons.end(), m_photonsBound, position, sqr(maxDistance), nearestBegin, nearestBegin, nearestEnd);
             }
 
         private:
@@ -55,7 +57,7 @@ namespace photon_mapping {
                 int splitAxis = maxAxis(bound);
                 if (level == 0) {
                     std::sort(begin, end, [=](Photon const& a, Photon const& b) {
-                        return a.position[splitAxis] < b.position[splitAxis];
+                        return a.position()[splitAxis] < b.position()[splitAxis];
                     });
                     return;
                 }
@@ -63,11 +65,11 @@ namespace photon_mapping {
                 int mask = 1 << (level - 1);
                 if ((subtree & mask) == 0) {
                     Segment3f belowBound = bound;
-                    belowBound.max[splitAxis] = median->position[splitAxis];
+                    belowBound.max[splitAxis] = median->position()[splitAxis];
                     buildLevelOnSubtree(level - 1, subtree & ~mask, begin, median, belowBound);
                 } else {
                     Segment3f aboveBound = bound;
-                    aboveBound.min[splitAxis] = median->position[splitAxis];
+                    aboveBound.min[splitAxis] = median->position()[splitAxis];
                     buildLevelOnSubtree(level - 1, subtree & ~mask, median + 1, end, aboveBound);
                 }
             }
@@ -78,47 +80,50 @@ namespace photon_mapping {
                 }
             };
 
-            static std::vector<NearestPhoton>::iterator nearest(std::vector<Photon>::const_iterator begin, std::vector<Photon>::const_iterator end, Segment3f const& bound, Point3f const& position, std::vector<NearestPhoton>::iterator nearestBegin, std::vector<NearestPhoton>::iterator nearestNext, std::vector<NearestPhoton>::iterator nearestEnd) {
+            static std::vector<NearestPhoton>::iterator nearest(std::vector<Photon>::const_iterator begin, std::vector<Photon>::const_iterator end, Segment3f const& bound, Point3f const& position, float maxSqrDistance, std::vector<NearestPhoton>::iterator nearestBegin, std::vector<NearestPhoton>::iterator nearestNext, std::vector<NearestPhoton>::iterator nearestEnd) {
                 if (begin == end) {
                     return nearestNext;
                 }
                 
                 std::vector<Photon>::const_iterator median = begin + (end - begin) / 2;
-                float medianSqrDistance = sqrDistance(median->position, position);
+                float medianSqrDistance = sqrDistance(median->position(), position);
 
                 if (nearestNext == nearestEnd) {
                     if (medianSqrDistance < nearestBegin->sqrDistance) {
+                        PHOTON_MAPPING_COUNT(photonHeapOperations, 2);
                         std::pop_heap(nearestBegin, nearestNext--, SqrDistanceLess());
                         nearestNext->photon = median;
                         nearestNext->sqrDistance = medianSqrDistance;
                         std::push_heap(nearestBegin, ++nearestNext, SqrDistanceLess());
                     }
-                } else {
+                } else if (medianSqrDistance < maxSqrDistance) {
+                    PHOTON_MAPPING_COUNT(photonHeapOperations, 1);
                     nearestNext->photon = median;
                     nearestNext->sqrDistance = medianSqrDistance;
                     std::push_heap(nearestBegin, ++nearestNext, SqrDistanceLess());
                 }
 
                 int splitAxis = maxAxis(bound);
-                if (position[splitAxis] <= median->position[splitAxis]) {
+                if (position[splitAxis] <= median->position()[splitAxis]) {
                     Segment3f belowBound = bound;
-                    belowBound.max[splitAxis] = median->position[splitAxis];
-                    nearestNext = nearest(begin, median, belowBound, position, nearestBegin, nearestNext, nearestEnd);
+                    belowBound.max[splitAxis] = median->position()[splitAxis];
+                    nearestNext = nearest(begin, median, belowBound, position, maxSqrDistance, nearestBegin, nearestNext, nearestEnd);
                 } else {
                     Segment3f aboveBound = bound;
-                    aboveBound.min[splitAxis] = median->position[splitAxis];
-                    nearestNext = nearest(median + 1, end, aboveBound, position, nearestBegin, nearestNext, nearestEnd);
+                    aboveBound.min[splitAxis] = median->position()[splitAxis];
+                    nearestNext = nearest(median + 1, end, aboveBound, position, maxSqrDistance, nearestBegin, nearestNext, nearestEnd);
                 }
 
-                if (nearestNext != nearestEnd || sqr(median->position[splitAxis] - position[splitAxis]) < nearestBegin->sqrDistance) {
-                    if (position[splitAxis] <= median->position[splitAxis]) {
+                float searchSqrDistance = (nearestNext != nearestEnd) ? maxSqrDistance : nearestBegin->sqrDistance;
+                if (sqr(median->position()[splitAxis] - position[splitAxis]) < searchSqrDistance) {
+                    if (position[splitAxis] <= median->position()[splitAxis]) {
                         Segment3f aboveBound = bound;
-                        aboveBound.min[splitAxis] = median->position[splitAxis];
-                        nearestNext = nearest(median + 1, end, aboveBound, position, nearestBegin, nearestNext, nearestEnd);
+                        aboveBound.min[splitAxis] = median->position()[splitAxis];
+                        nearestNext = nearest(median + 1, end, aboveBound, position, maxSqrDistance, nearestBegin, nearestNext, nearestEnd);
                     } else {
                         Segment3f belowBound = bound;
-                        belowBound.max[splitAxis] = median->position[splitAxis];
-                        nearestNext = nearest(begin, median, belowBound, position, nearestBegin, nearestNext, nearestEnd);
+                        belowBound.max[splitAxis] = median->position()[splitAxis];
+                        nearestNext = nearest(begin, median, belowBound, position, maxSqrDistance, nearestBegin, nearestNext, nearestEnd);
                     }
                 }
                 return nearestNext;
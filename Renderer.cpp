@@ -1,11 +1,46 @@
 #include "Renderer.hpp"
 
+#include <cstring>
+
 #include <QDebug>
 
 #include "mathFunctions.hpp"
+#include "lowDiscrepancy.hpp"
 
 namespace photon_mapping {
-    Photon Renderer::emitAndScatter(Random &random) {
+    namespace {
+        bool isPreviewNode(int coordinate, int begin, int end, int spacing) {
+            return (coordinate - begin) % spacing == 0 || coordinate == end - 1;
+        }
+
+        float previewNodeSimilarity(Surface::Row const& row, int x, Surface::Row const& referenceRow, int referenceX) {
+            float depth = row.depth(x);
+            float referenceDepth = referenceRow.depth(referenceX);
+            if (depth == inf() || referenceDepth == inf()) {
+                return (depth == referenceDepth) ? 1.0f : 0.0f;
+            }
+            if (abs(depth - referenceDepth) > 0.1f * referenceDepth) {
+                return 0.0f;
+            }
+            if (dot(row.normal(x), referenceRow.normal(referenceX)) < 0.9f) {
+                return 0.0f;
+            }
+            return 1.0f;
+        }
+
+        std::uint32_t positionHash(Point3f const& position) {
+            float const coordinates[3] = {position.x, position.y, position.z};
+            std::uint32_t hash = 2166136261u;
+            for (int i = 0; i < 3; ++i) {
+                std::uint32_t bits;
+                std::memcpy(&bits, &coordinates[i], sizeof(bits));
+                hash = (hash ^ bits) * 16777619u;
+            }
+            return hash;
+        }
+    }
+
+    void Renderer::emitAndScatter(Random &random, bool caustic, std::vector<Photon>& photons, std::size_t maxPhotonCount) {
         float currentRefractionIndex = 1.0;
         Scene::Sample sample;
         do {
@@ -17,11 +52,10 @@ namespace photon_mapping {
         do {
             ray.direction = random.cosineDirection(sample.normal);
         } while (!scene()->hit(ray, hitDistance, hit));
-        Photon photon;
-        photon.position = hit.position;
-        photon.direction = ray.direction;
-        photon.power = sample.emission * sample.emissionPower;
-        while (true) {
+        Color power = sample.emission * sample.emissionPower;
+        bool specularPath = false;
+        bool diffusePath = false;
+        while (photons.size() < maxPhotonCount) {
             float action = random.uniformInRange01();
 
             float specularLuminance = luminance(hit.specular);
@@ -32,11 +66,9 @@ namespace photon_mapping {
                 reflectedRay.origin += reflectedRay.direction * 0.001f;
                 ray = reflectedRay;
                 if (!scene()->hit(ray, hitDistance, hit)) {
-                    photon.power = Color::BLACK;
-                    break;
+                    return;
                 }
-                photon.position = hit.position;
-                photon.direction = ray.direction;
+                specularPath = true;
                 continue;
             } else {
                 action -= specularLuminance;
@@ -54,64 +86,181 @@ namespace photon_mapping {
                 transmittedRay.origin += transmittedRay.direction * 0.001f;
                 ray = transmittedRay;
                 if (nan(sqrLength(ray.direction)) || !scene()->hit(ray, hitDistance, hit)) {
-                    photon.power = Color::BLACK;
-                    break;
+                    return;
                 }
-                photon.position = hit.position;
-                photon.direction = ray.direction;
+                specularPath = true;
                 continue;
             } else {
                 action -= transmissionLuminance;
             }
 
+            if (caustic) {
+                if (specularPath) {
+                    photons.push_back(Photon(hit.position, ray.direction, power));
+                }
+                return;
+            }
+            if (diffusePath || !specularPath) {
+                photons.push_back(Photon(hit.position, ray.direction, power));
+            }
+
+            float diffuseLuminance = luminance(hit.diffuse);
+            if (action < diffuseLuminance) {
+                power *= hit.diffuse / diffuseLuminance;
+                Ray diffusedRay;
+                diffusedRay.origin = hit.position;
+                diffusedRay.direction = random.cosineDirection((dot(hit.normal, ray.direction) <= 0.0f) ? +hit.normal : -hit.normal);
+                diffusedRay.origin += diffusedRay.direction * 0.001f;
+                ray = diffusedRay;
+                if (!scene()->hit(ray, hitDistance, hit)) {
+                    return;
+                }
+                diffusePath = true;
+                continue;
+            }
+
             // absorbtion;
-            break;
+            return;
         }
-        return photon;
     }
 
-    void Renderer::scatterPart(Random& random, std::vector<Photon>::iterator begin, std::vector<Photon>::iterator end) {
+    int Renderer::scatterPart(Random& random, bool caustic, int photonCount, std::vector<Photon>& photons) {
+        static int const MAX_EMITTED_COUNT_PER_PHOTON = 32;
         if (scene()->empty()) {
-            return;
+            return 0;
         }
-        for (std::vector<Photon>::iterator p = begin; p != end; ++p) {
-            *p = emitAndScatter(random);
+        int maxEmittedCount = MAX_EMITTED_COUNT_PER_PHOTON * photonCount;
+        int emittedCount = 0;
+        while (int(photons.size()) < photonCount && emittedCount < maxEmittedCount) {
+            checkInterrupts();
+            ++emittedCount;
+            emitAndScatter(random, caustic, photons, photonCount);
         }
+        return emittedCount;
     }
 
-    Color Renderer::render(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Ray const& ray, int rayBounceCount) const {      
-        Color radiance = Color::BLACK;
-        
+    Color Renderer::gather(PhotonMap const& photonMap, int emittedPhotonCount, int gatherCount, float gatherRadius, std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Ray const& ray, Scene::Sample const& hit) const {
+        if (emittedPhotonCount == 0) {
+            return Color::BLACK;
+        }
+        auto nearestPhotonsEnd = photonMap.nearest(hit.position, nearestPhotons.begin(), nearestPhotons.begin() + gatherCount, gatherRadius);
+        if (nearestPhotonsEnd == nearestPhotons.begin()) {
+            return Color::BLACK;
+        }
+        Color photonRadiance = Color::BLACK;
+        Vector3f const& n = hit.normal;
+        Vector3f v = -ray.direction;
+        float gatherSqrDistance = (nearestPhotonsEnd - nearestPhotons.begin() == gatherCount || gatherRadius == inf()) ? nearestPhotons.begin()->sqrDistance : sqr(gatherRadius);
+        for (auto nearestPhoton = nearestPhotons.begin(); nearestPhoton != nearestPhotonsEnd; ++nearestPhoton) {
+            Photon const& photon = *nearestPhoton->photon;
+            Vector3f l = -photon.direction();
+            Color power = photon.power();
+            float ln = dot(l, n);
+            if (ln > 0.0f) {
+                photonRadiance += hit.diffuse * ln * power;
+                Vector3f r = reflect(-l, n);
+                float rv = dot(r, v);
+                if (rv > 0.0f) {
+                    photonRadiance += hit.specular * pow(rv, hit.specularPower) * power;
+                }
+            }
+        }
+        return photonRadiance / (pi() * gatherSqrDistance * emittedPhotonCount);
+    }
+
+    Color Renderer::directLight(Point3f const& position, Vector3f const& normal) const {
+        static int const SHADOW_RAY_COUNT = 16;
+        if (!scene()->hasEmitter()) {
+            return Color::BLACK;
+        }
+        std::uint32_t scramble = ~positionHash(position);
+        Color irradianceSum = Color::BLACK;
+        for (int sample = 0; sample < SHADOW_RAY_COUNT; ++sample) {
+            Scene::Sample emitter = scene()->uniformOnEmitter(sobol2(sample, scramble));
+            Vector3f offset = emitter.position - position;
+            float sqrDistance = sqrLength(offset);
+            float emitterDistance = sqrt(sqrDistance);
+            Vector3f direction = offset / emitterDistance;
+            float cosine = dot(normal, direction);
+            float emitterCosine = -dot(emitter.normal, direction);
+            if (cosine <= 0.0f || emitterCosine <= 0.0f) {
+                continue;
+            }
+            Ray ray;
+            ray.origin = position + direction * 0.001f;
+            ray.direction = direction;
+            float hitDistance; Scene::Hit hit;
+            if (scene()->hit(ray, hitDistance, hit) && hitDistance < emitterDistance - 0.002f) {
+                continue;
+            }
+            irradianceSum += emitter.emission * (emitter.emissionPower * cosine * emitterCosine / sqrDistance);
+        }
+        return irradianceSum * (scene()->emitterArea() / SHADOW_RAY_COUNT);
+    }
+
+    Color Renderer::finalGather(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Point3f const& position, Vector3f const& normal) const {
+        Color irradianceSum = Color::BLACK;
+        float weightSum = 0.0f;
+        irradianceCache().accumulate(position, normal, irradianceSum, weightSum);
+        tileIrradianceCache.accumulate(position, normal, irradianceSum, weightSum);
+        if (weightSum > 0.0f) {
+            PHOTON_MAPPING_COUNT(irradianceCacheHits, 1);
+            return irradianceSum / weightSum;
+        }
+        PHOTON_MAPPING_COUNT(irradianceCacheMisses, 1);
+        Extent3f sceneExtent = extent(scene()->bound());
+        float sceneSize = max(max(sceneExtent.x, sceneExtent.y), sceneExtent.z);
+        float minRadius = 0.001f * sceneSize;
+        float maxRadius = 0.1f * sceneSize;
+        Vector3f tangent = unit(cross(normal, (abs(normal.x) < 0.5f) ? Vector3f::UNIT_X : Vector3f::UNIT_Y));
+        Vector3f bitangent = cross(normal, tangent);
+        std::uint32_t scramble = positionHash(position);
+        Color radianceSum = Color::BLACK;
+        float inverseDistanceSum = 0.0f;
+        for (int sample = 0; sample < finalGatherRayCount(); ++sample) {
+            Point2f u = sobol2(sample, scramble);
+            float r = sqrt(u.x);
+            float phi = 2.0f * pi() * u.y;
+            Ray ray;
+            ray.origin = position;
+            ray.direction = tangent * (r * cos(phi)) + bitangent * (r * sin(phi)) + normal * sqrt(1.0f - u.x);
+            ray.origin += ray.direction * 0.001f;
+            float hitDistance; Scene::Sample hit;
+            if (scene()->hit(ray, hitDistance, hit)) {
+                radianceSum += gather(photonMap(), emittedPhotonCount(), photonGatherCount(), photonGatherRadius(), nearestPhotons, ray, hit);
+                radianceSum += gather(causticPhotonMap(), emittedCausticPhotonCount(), causticPhotonGatherCount(), causticPhotonGatherRadius(), nearestPhotons, ray, hit);
+                inverseDistanceSum += 1.0f / hitDistance;
+            } else {
+                inverseDistanceSum += 1.0f / maxRadius;
+            }
+        }
+        Color irradiance = radianceSum * (pi() / finalGatherRayCount());
+        tileIrradianceCache.insert(position, normal, clamp(minRadius, finalGatherRayCount() / inverseDistanceSum, maxRadius), irradiance);
+        return irradiance;
+    }
+
+    Color Renderer::render(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Ray const& ray, int rayBounceCount) const {      
         float hitDistance; Scene::Sample hit;
         if (!scene()->hit(ray, hitDistance, hit)) {
-            return radiance;
+            return Color::BLACK;
         }
-        
+        return shade(nearestPhotons, tileIrradianceCache, ray, hit, rayBounceCount);
+    }
+
+    Color Renderer::shade(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Ray const& ray, Scene::Sample const& hit, int rayBounceCount) const {
+        Color radiance = Color::BLACK;
+
         { // emitted radiance
             radiance += hit.emission * hit.emissionPower;
         }
         { // photon radiance
-            Color photonRadiance = Color::BLACK; 
-            auto nearestPhotonsEnd = photonMap().nearest(hit.position, nearestPhotons.begin(), nearestPhotons.end());
-            Vector3f const& n = hit.normal;
-            Vector3f v = -ray.direction;
-            auto farthestPhotonIt = nearestPhotons.begin();
-            float farthestPhotonSqrDistance = farthestPhotonIt->sqrDistance;
-            for (auto& nearestPhoton : nearestPhotons) {
-                Photon const& photon = *nearestPhoton.photon;
-                Vector3f l = -photon.direction;
-                float ln = dot(l, n);
-                if (ln > 0.0f) {
-                    photonRadiance += hit.diffuse * ln * photon.power;
-                    Vector3f r = reflect(-l, n);
-                    float rv = dot(r, v);
-                    if (rv > 0.0f) {
-                        photonRadiance += hit.specular * pow(rv, hit.specularPower) * photon.power;
-                    }
-                }
+            if (finalGatherRayCount() == 0) {
+                radiance += gather(photonMap(), emittedPhotonCount(), photonGatherCount(), photonGatherRadius(), nearestPhotons, ray, hit);
+            } else if (luminance(hit.diffuse) > 0.0f) {
+                Vector3f normal = (dot(hit.normal, ray.direction) <= 0.0f) ? +hit.normal : -hit.normal;
+                radiance += hit.diffuse * (directLight(hit.position, normal) + finalGather(nearestPhotons, tileIrradianceCache, hit.position, normal)) / pi();
             }
-            photonRadiance /= pi() * farthestPhotonSqrDistance * photonCount();
-            radiance += photonRadiance;
+            radiance += gather(causticPhotonMap(), emittedCausticPhotonCount(), causticPhotonGatherCount(), causticPhotonGatherRadius(), nearestPhotons, ray, hit);
         }
         { // reflected radiance
             if (rayBounceCount + 1 < maxRayBounceCount() && luminance(hit.specular) > 0.0f) {
@@ -119,7 +268,7 @@ namespace photon_mapping {
                 reflectedRay.origin = hit.position;
                 reflectedRay.direction = reflect(ray.direction, hit.normal);
                 reflectedRay.origin += reflectedRay.direction * 0.001f;
-                radiance += hit.specular * render(nearestPhotons, reflectedRay, rayBounceCount + 1);
+                radiance += hit.specular * render(nearestPhotons, tileIrradianceCache, reflectedRay, rayBounceCount + 1);
             }
         }
         { // transmitted radiance
@@ -133,74 +282,115 @@ namespace photon_mapping {
                 }
                 transmittedRay.origin += transmittedRay.direction * 0.001f;
                 if (!nan(sqrLength(transmittedRay.direction))) {
-                    radiance += hit.transmission * render(nearestPhotons, transmittedRay, rayBounceCount + 1);
+                    radiance += hit.transmission * render(nearestPhotons, tileIrradianceCache, transmittedRay, rayBounceCount + 1);
                 }
             }
         }
         return radiance;
     }
 
-    void Renderer::renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Segment2i const& segment) {
+    int Renderer::renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Segment2i const& segment, int quality) {
         Extent2i sufraceExtent = surface()->extent();
-        if (quality() < 0) {
-            float idealSampleSize = 1 << -quality();
-            Extent2i pixelCount = extent(segment);
-            idealSampleSize = min(idealSampleSize, (float)pixelCount.x);
-            idealSampleSize = min(idealSampleSize, (float)pixelCount.y);
-            Extent2i sampleCount;
-            sampleCount.x = pixelCount.x / idealSampleSize;
-            sampleCount.y = pixelCount.y / idealSampleSize;
-            Extent2i pixelCountPerSample;
-            pixelCountPerSample.x = pixelCount.x / sampleCount.x;
-            pixelCountPerSample.y = pixelCount.y / sampleCount.y;
-            Extent2i leftoverPixelCount;
-            leftoverPixelCount.x = pixelCount.x - pixelCountPerSample.x * sampleCount.x;
-            leftoverPixelCount.y = pixelCount.y - pixelCountPerSample.y * sampleCount.y;
-            Point2i pixelPositionBegin;
-            Point2i pixelPositionEnd;
-            Point2f samplePosition;
-            Point2i sample;
-            for (sample.y = 0; sample.y < sampleCount.y; ++sample.y) {
-                pixelPositionBegin.y = segment.min.y + pixelCountPerSample.y * (sample.y + 0) + min(sample.y + 0, leftoverPixelCount.y);
-                pixelPositionEnd.y = segment.min.y + pixelCountPerSample.y * (sample.y + 1) + min(sample.y + 1, leftoverPixelCount.y);
-                samplePosition.y = floor((pixelPositionBegin.y + pixelPositionEnd.y) / 2.0f);
-                for (sample.x = 0; sample.x < sampleCount.x; ++sample.x) {
-                    pixelPositionBegin.x = segment.min.x + pixelCountPerSample.x * (sample.x + 0) + min(sample.x + 0, leftoverPixelCount.x);
-                    pixelPositionEnd.x = segment.min.x + pixelCountPerSample.x * (sample.x + 1) + min(sample.x + 1, leftoverPixelCount.x);
-                    samplePosition.x = floor((pixelPositionBegin.x + pixelPositionEnd.x) / 2.0f);
-                    Ray ray = camera()->cast(samplePosition, sufraceExtent);
-                    Color sampleColor = render(nearestPhotons, ray);
-                    Color pixelColor = clamp(Color::BLACK, sampleColor, Color::WHITE);
-                    Point2i pixelPosition;
-                    for (pixelPosition.y = pixelPositionBegin.y; pixelPosition.y < pixelPositionEnd.y; ++pixelPosition.y) {
-                        for (pixelPosition.x = pixelPositionBegin.x; pixelPosition.x < pixelPositionEnd.x; ++pixelPosition.x) {
-                            checkInterrupts();
-                            surface()->setPixel(pixelPosition, pixelColor);
-                        }
+        if (quality < 0) {
+            int spacing = 1 << -quality;
+            bool reuseCoarseNodes = quality > initialQuality();
+            Point2i pixelPosition;
+            for (pixelPosition.y = segment.min.y; pixelPosition.y < segment.max.y; ++pixelPosition.y) {
+                if (!isPreviewNode(pixelPosition.y, segment.min.y, segment.max.y, spacing)) {
+                    continue;
+                }
+                bool coarseRow = isPreviewNode(pixelPosition.y, segment.min.y, segment.max.y, 2 * spacing);
+                Surface::Row surfaceRow = surface()->row(pixelPosition.y);
+                for (pixelPosition.x = segment.min.x; pixelPosition.x < segment.max.x; ++pixelPosition.x) {
+                    if (!isPreviewNode(pixelPosition.x, segment.min.x, segment.max.x, spacing)) {
+                        continue;
+                    }
+                    if (reuseCoarseNodes && coarseRow && isPreviewNode(pixelPosition.x, segment.min.x, segment.max.x, 2 * spacing)) {
+                        continue;
+                    }
+                    checkInterrupts();
+                    Ray ray = camera()->cast(Point2f(pixelPosition.x, pixelPosition.y), sufraceExtent);
+                    float hitDistance; Scene::Sample hit;
+                    if (scene()->hit(ray, hitDistance, hit)) {
+                        surfaceRow.setPixel(pixelPosition.x, shade(nearestPhotons, tileIrradianceCache, ray, hit));
+                        surfaceRow.setGeometry(pixelPosition.x, hitDistance, hit.normal);
+                    } else {
+                        surfaceRow.setPixel(pixelPosition.x, Color::BLACK);
+                        surfaceRow.setGeometry(pixelPosition.x, inf(), Vector3f::ZERO);
                     }
                 }
             }
+            for (pixelPosition.y = segment.min.y; pixelPosition.y < segment.max.y; ++pixelPosition.y) {
+                checkInterrupts();
+                bool nodeRow = isPreviewNode(pixelPosition.y, segment.min.y, segment.max.y, spacing);
+                int y0 = segment.min.y + (pixelPosition.y - segment.min.y) / spacing * spacing;
+                int y1 = min(y0 + spacing, segment.max.y - 1);
+                float ty = (y1 > y0) ? float(pixelPosition.y - y0) / (y1 - y0) : 0.0f;
+                Surface::Row surfaceRow = surface()->row(pixelPosition.y);
+                Surface::Row surfaceRow0 = surface()->row(y0);
+                Surface::Row surfaceRow1 = surface()->row(y1);
+                for (pixelPosition.x = segment.min.x; pixelPosition.x < segment.max.x; ++pixelPosition.x) {
+                    if (nodeRow && isPreviewNode(pixelPosition.x, segment.min.x, segment.max.x, spacing)) {
+                        continue;
+                    }
+                    int x0 = segment.min.x + (pixelPosition.x - segment.min.x) / spacing * spacing;
+                    int x1 = min(x0 + spacing, segment.max.x - 1);
+                    float tx = (x1 > x0) ? float(pixelPosition.x - x0) / (x1 - x0) : 0.0f;
+                    Surface::Row const* cornerRows[4] = {&surfaceRow0, &surfaceRow0, &surfaceRow1, &surfaceRow1};
+                    int cornerXs[4] = {x0, x1, x0, x1};
+                    float cornerWeights[4] = {(1.0f - tx) * (1.0f - ty), tx * (1.0f - ty), (1.0f - tx) * ty, tx * ty};
+                    int nearestCorner = (tx < 0.5f ? 0 : 1) + (ty < 0.5f ? 0 : 2);
+                    Color radiance = Color::BLACK;
+                    float weightSum = 0.0f;
+                    for (int corner = 0; corner < 4; ++corner) {
+                        float weight = cornerWeights[corner] * previewNodeSimilarity(*cornerRows[corner], cornerXs[corner], *cornerRows[nearestCorner], cornerXs[nearestCorner]);
+                        radiance += cornerRows[corner]->radiance(cornerXs[corner]) * weight;
+                        weightSum += weight;
+                    }
+                    surfaceRow.setPixel(pixelPosition.x, radiance / weightSum);
+                }
+            }
+            Extent2i pixelCount = extent(segment);
+            return pixelCount.x * pixelCount.y;
         } else {
-            int sampleCount = 1 << quality();
-            float sampleDistance = 1.0f / sampleCount;
-            float sampleWeight = 1.0f / sqr(sampleCount);
+            bool accumulate = quality > max(initialQuality(), 0);
+            bool adaptive = accumulate && adaptiveThreshold() > 0.0f;
+            bool reusePreviewNodes = quality == 0 && initialQuality() < 0;
+            int sampleBegin = accumulate ? 1 << (2 * (quality - 1)) : 0;
+            int sampleEnd = 1 << (2 * quality);
+            int sampledPixelCount = 0;
             Point2i pixelPosition;
             for (pixelPosition.y = segment.min.y; pixelPosition.y < segment.max.y; ++pixelPosition.y) {
+                Surface::Row surfaceRow = surface()->row(pixelPosition.y);
+                bool previewNodeRow = reusePreviewNodes && isPreviewNode(pixelPosition.y, segment.min.y, segment.max.y, 2);
                 for (pixelPosition.x = segment.min.x; pixelPosition.x < segment.max.x; ++pixelPosition.x) {
                     checkInterrupts();
-                    Color sampleColor = Color::BLACK;
-                    Point2f subPixelPosition;
-                    for (subPixelPosition.y = sampleDistance / 2.0f; subPixelPosition.y < 1.0f; subPixelPosition.y += sampleDistance) {
-                        for (subPixelPosition.x = sampleDistance / 2.0f; subPixelPosition.x < 1.0f; subPixelPosition.x += sampleDistance) {
-                            Point2f samplePosition = Point2f(pixelPosition.x + subPixelPosition.x, pixelPosition.y + subPixelPosition.y);
-                            Ray ray = camera()->cast(samplePosition, sufraceExtent);
-                            sampleColor += render(nearestPhotons, ray) * sampleWeight;
-                        }
+                    if (previewNodeRow && isPreviewNode(pixelPosition.x, segment.min.x, segment.max.x, 2)) {
+                        ++sampledPixelCount;
+                        continue;
+                    }
+                    if (adaptive && surfaceRow.relativeError(pixelPosition.x) < adaptiveThreshold()) {
+                        continue;
+                    }
+                    Color radianceSum = Color::BLACK;
+                    float sqrLuminanceSum = 0.0f;
+                    for (int sample = sampleBegin; sample < sampleEnd; ++sample) {
+                        Point2f subPixelPosition = sobol2(sample, 0x80000000);
+                        Point2f samplePosition = Point2f(pixelPosition.x + subPixelPosition.x - 0.5f, pixelPosition.y + subPixelPosition.y - 0.5f);
+                        Ray ray = camera()->cast(samplePosition, sufraceExtent);
+                        Color sampleRadiance = render(nearestPhotons, tileIrradianceCache, ray);
+                        radianceSum += sampleRadiance;
+                        sqrLuminanceSum += sqr(luminance(sampleRadiance));
+                    }
+                    if (accumulate) {
+                        surfaceRow.addSamples(pixelPosition.x, radianceSum, sqrLuminanceSum, sampleEnd - sampleBegin);
+                    } else {
+                        surfaceRow.setSamples(pixelPosition.x, radianceSum, sqrLuminanceSum, sampleEnd - sampleBegin);
                     }
-                    Color pixelColor = clamp(Color::BLACK, sampleColor, Color::WHITE);
-                    surface()->setPixel(pixelPosition, pixelColor);
+                    ++sampledPixelCount;
                 }
             }
+            return sampledPixelCount;
         }
     }
 }
\ No newline at end of file
@@ -13,10 +13,14 @@ namespace photon_mapping {
         public:
 
         private:
-            Photon Renderer::emitAndScatter(Random &random);
-            virtual void scatterPart(Random& random, std::vector<Photon>::iterator begin, std::vector<Photon>::iterator end);
-            Color render(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Ray const& ray, int rayBounceCount = 0) const;
-            virtual void renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Segment2i const& segment);
+            void emitAndScatter(Random &random, bool caustic, std::vector<Photon>& photons, std::size_t maxPhotonCount);
+            virtual int scatterPart(Random& random, bool caustic, int photonCount, std::vector<Photon>& photons);
+            Color gather(PhotonMap const& photonMap, int emittedPhotonCount, int gatherCount, float gatherRadius, std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Ray const& ray, Scene::Sample const& hit) const;
+            Color directLight(Point3f const& position, Vector3f const& normal) const;
+            Color finalGather(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Point3f const& position, Vector3f const& normal) const;
+            Color render(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Ray const& ray, int rayBounceCount = 0) const;
+            Color shade(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Ray const& ray, Scene::Sample const& hit, int rayBounceCount = 0) const;
+            virtual int renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Segment2i const& segment, int quality);
     };
 }
 
@@ -1,22 +1,95 @@
 #include "RendererBase.hpp"
 
+#include <algorithm>
+
 #include <QMutexLocker>
-#include <QDebug>
+#include <QElapsedTimer>
 
 #include "mathFunctions.hpp"
+#include "Trace.hpp"
 
 namespace photon_mapping {
+    namespace {
+        void accumulate(RendererBase::PhaseStatistics& total, RendererBase::PhaseStatistics const& part) {
+            total.workers.resize(part.workers.size());
+            for (std::size_t workerIndex = 0; workerIndex < part.workers.size(); ++workerIndex) {
+                total.workers[workerIndex].nsecs += part.workers[workerIndex].nsecs;
+                total.workers[workerIndex].barrierWaitNsecs += part.workers[workerIndex].barrierWaitNsecs;
+                total.workers[workerIndex].counters += part.workers[workerIndex].counters;
+            }
+            total.nsecs += part.nsecs;
+            total.counters += part.counters;
+        }
+
+        void partition(int count, int partCount, int part, int& begin, int& end) {
+            int countPerPart = count / partCount;
+            int leftoverCount = count - countPerPart * partCount;
+            begin = countPerPart * (part + 0) + min(part + 0, leftoverCount);
+            end = countPerPart * (part + 1) + min(part + 1, leftoverCount);
+        }
+
+        void merge(std::vector<Photon>& photons, std::vector<std::vector<Photon>>& buffers) {
+            std::size_t photonCount = 0;
+            for (auto const& buffer : buffers) {
+                photonCount += buffer.size();
+            }
+            photons.clear();
+            photons.reserve(photonCount);
+            for (auto& buffer : buffers) {
+                photons.insert(photons.end(), buffer.begin(), buffer.end());
+                buffer.clear();
+                buffer.shrink_to_fit();
+            }
+        }
+    }
+
+    RendererBase::WorkerStatistics::WorkerStatistics()
+        : nsecs(0)
+        , barrierWaitNsecs(0)
+    {}
+
+    RendererBase::PhaseStatistics::PhaseStatistics()
+        : nsecs(0)
+    {}
+
     RendererBase::RendererBase()
-        : m_photons(10000)
+        : m_photonCount(10000)
+        , m_photonGatherCount(100)
+        , m_photonGatherRadius(inf())
+        , m_emittedPhotonCount(0)
+        , m_photonMap(m_photons)
+        , m_causticPhotonCount(10000)
+        , m_causticPhotonGatherCount(50)
+        , m_causticPhotonGatherRadius(0.1f)
+        , m_emittedCausticPhotonCount(0)
+        , m_causticPhotonMap(m_causticPhotons)
         , m_photonsScattered(false)
         , m_mapLevelsBuilt(0)
-        , m_photonMap(m_photons)
-        , m_nearestPhotonBuffers(workerCount(), std::vector<PhotonMap::NearestPhoton>(100))
+        , m_scatteredPhotonBuffers(workerCount())
+        , m_emittedPhotonCounts(workerCount())
+        , m_scatteredCausticPhotonBuffers(workerCount())
+        , m_emittedCausticPhotonCounts(workerCount())
+        , m_nearestPhotonBuffers(workerCount())
+        , m_finalGatherRayCount(0)
         , m_initialQuality(-4)
         , m_quality(m_initialQuality)
         , m_finalQuality(2)
         , m_maxRayBounceCount(4)
-    {}
+        , m_adaptiveThreshold(0.0f)
+        , m_seed(1)
+        , m_hasPriorityRegion(false)
+        , m_nextTile(0)
+        , m_renderedTiles(workerCount())
+        , m_tilesInProgress(workerCount(), -1)
+        , m_tileSamples(workerCount())
+        , m_taskPartNsecs(workerCount())
+        , m_taskPartCounters(workerCount())
+    {
+        resizeNearestPhotonBuffers();
+        for (int workerIndex = 0; workerIndex < workerCount(); ++workerIndex) {
+            m_tileIrradianceCaches.push_back(std::unique_ptr<IrradianceCache>(new IrradianceCache()));
+        }
+    }
 
     void RendererBase::setScene(std::shared_ptr<Scene> const& scene) {
         m_scene = scene;
@@ -24,9 +97,17 @@ namespace photon_mapping {
 
     void RendererBase::invalidateScene() {
         m_scene->invalidate();
+        m_photons.clear();
+        m_photons.shrink_to_fit();
+        m_causticPhotons.clear();
+        m_causticPhotons.shrink_to_fit();
+        m_irradianceCache.reset(m_scene->bound());
         m_photonsScattered = false;
         m_mapLevelsBuilt = 0;
         m_quality = m_initialQuality;
+        clearTileQualities();
+        QMutexLocker statisticsGuardLocker(&m_statisticsGuard);
+        m_statistics = Statistics();
     }
 
     void RendererBase::setCamera(std::shared_ptr<Camera> const& camera) {
@@ -34,7 +115,10 @@ namespace photon_mapping {
     }
 
     void RendererBase::invalidateCamera() {
-         m_quality = m_initialQuality;
+        m_quality = m_initialQuality;
+        clearTileQualities();
+        QMutexLocker statisticsGuardLocker(&m_statisticsGuard);
+        m_statistics.render.clear();
     }
 
     void RendererBase::setSurface(std::shared_ptr<Surface> const& surface) {
@@ -42,15 +126,42 @@ namespace photon_mapping {
     }
 
     void RendererBase::setPhotonCount(int photonCount) {
-        m_photons.resize(photonCount);
-        m_photons.shrink_to_fit();
+        m_photonCount = photonCount;
     }
 
     void RendererBase::setPhotonGatherCount(int photonGatherCount) {
-        for (auto& nearestPhotonBuffer : m_nearestPhotonBuffers) {
-            nearestPhotonBuffer.resize(photonGatherCount);
-            nearestPhotonBuffer.shrink_to_fit();
-        }
+        m_photonGatherCount = photonGatherCount;
+        resizeNearestPhotonBuffers();
+        m_irradianceCache.clear();
+    }
+
+    void RendererBase::setPhotonGatherRadius(float photonGatherRadius) {
+        m_photonGatherRadius = photonGatherRadius;
+        m_irradianceCache.clear();
+    }
+
+    void RendererBase::setCausticPhotonCount(int causticPhotonCount) {
+        m_causticPhotonCount = causticPhotonCount;
+    }
+
+    void RendererBase::setCausticPhotonGatherCount(int causticPhotonGatherCount) {
+        m_causticPhotonGatherCount = causticPhotonGatherCount;
+        resizeNearestPhotonBuffers();
+        m_irradianceCache.clear();
+    }
+
+    void RendererBase::setCausticPhotonGatherRadius(float causticPhotonGatherRadius) {
+        m_causticPhotonGatherRadius = causticPhotonGatherRadius;
+        m_irradianceCache.clear();
+    }
+
+    void RendererBase::setFinalGatherRayCount(int finalGatherRayCount) {
+        m_finalGatherRayCount = finalGatherRayCount;
+        m_irradianceCache.clear();
+    }
+
+    void RendererBase::setIrradianceCacheMaxError(float irradianceCacheMaxError) {
+        m_irradianceCache.setMaxError(irradianceCacheMaxError);
     }
 
     void RendererBase::setInitialQuality(int initialQuality) {
@@ -59,6 +170,7 @@ namespace photon_mapping {
 
     void RendererBase::setQuality(int quality) {
         m_quality = quality;
+        clearTileQualities();
     }
 
     void RendererBase::setFinalQuality(int finalQuality) {
@@ -69,74 +181,259 @@ namespace photon_mapping {
         m_maxRayBounceCount = maxRayBounceCount;
     }
 
+    void RendererBase::setAdaptiveThreshold(float adaptiveThreshold) {
+        m_adaptiveThreshold = adaptiveThreshold;
+    }
+
+    void RendererBase::setSeed(std::uint32_t seed) {
+        m_seed = seed;
+    }
+
+    void RendererBase::setPriorityRegion(Segment2i const& priorityRegion) {
+        m_hasPriorityRegion = true;
+        m_priorityRegion = priorityRegion;
+    }
+
+    void RendererBase::clearPriorityRegion() {
+        m_hasPriorityRegion = false;
+    }
+
+    RendererBase::Statistics RendererBase::statistics() const {
+        QMutexLocker statisticsGuardLocker(&m_statisticsGuard);
+        return m_statistics;
+    }
+
     bool RendererBase::nextTask() {
         if (!m_photonsScattered) {
             return true;
         }
-        if (m_mapLevelsBuilt < m_photonMap.levelCount()) {
+        if (m_mapLevelsBuilt < mapLevelCount()) {
             return true;
         }
         if (m_quality < m_finalQuality) {
-            m_elapsedTimer.restart();
             return true;
         }
         return false;
     }
 
     void RendererBase::doTaskPart(int workerIndex) {
+        QElapsedTimer taskPartTimer;
+        taskPartTimer.start();
+        Counters taskPartCounters;
+        CountersScope taskPartCountersScope(taskPartCounters);
         if (!m_photonsScattered) {
-            Random random(workerIndex + 1);
-            int photonCountPerWorker = photonCount() / workerCount();
-            int leftoverPhotonCount = photonCount() - photonCountPerWorker * workerCount();
-            int thisWorkerPhotonsBegin = photonCountPerWorker * (workerIndex + 0) + min(workerIndex + 0, leftoverPhotonCount);
-            int thisWorkerPhotonsEnd = photonCountPerWorker * (workerIndex + 1) + min(workerIndex + 1, leftoverPhotonCount);
-            scatterPart(random, m_photons.begin() + thisWorkerPhotonsBegin, m_photons.begin() + thisWorkerPhotonsEnd);
-            return;
-        }
-        if (m_mapLevelsBuilt < m_photonMap.levelCount()) {
-            int subtreeCountPerWorker = m_photonMap.subtreeCountAtLevel(m_mapLevelsBuilt) / workerCount();
-            int leftoverSubtreeCount = m_photonMap.subtreeCountAtLevel(m_mapLevelsBuilt) - subtreeCountPerWorker * workerCount();
-            int thisWorkerSubtreesBegin = subtreeCountPerWorker * (workerIndex + 0) + min(workerIndex + 0, leftoverSubtreeCount);
-            int thisWorkerSubtreesEnd = subtreeCountPerWorker * (workerIndex + 1) + min(workerIndex + 1, leftoverSubtreeCount);
+            PHOTON_MAPPING_TRACE_SCOPE("scatter");
+            Random random(m_seed + workerIndex);
+            int thisWorkerPhotonsBegin, thisWorkerPhotonsEnd;
+            partition(m_photonCount, workerCount(), workerIndex, thisWorkerPhotonsBegin, thisWorkerPhotonsEnd);
+            std::vector<Photon>& scatteredPhotons = m_scatteredPhotonBuffers[workerIndex];
+            scatteredPhotons.clear();
+            scatteredPhotons.reserve(thisWorkerPhotonsEnd - thisWorkerPhotonsBegin);
+            m_emittedPhotonCounts[workerIndex] = scatterPart(random, false, thisWorkerPhotonsEnd - thisWorkerPhotonsBegin, scatteredPhotons);
+            int thisWorkerCausticPhotonsBegin, thisWorkerCausticPhotonsEnd;
+            partition(m_scene->hasSpecularMaterial() ? m_causticPhotonCount : 0, workerCount(), workerIndex, thisWorkerCausticPhotonsBegin, thisWorkerCausticPhotonsEnd);
+            std::vector<Photon>& scatteredCausticPhotons = m_scatteredCausticPhotonBuffers[workerIndex];
+            scatteredCausticPhotons.clear();
+            scatteredCausticPhotons.reserve(thisWorkerCausticPhotonsEnd - thisWorkerCausticPhotonsBegin);
+            m_emittedCausticPhotonCounts[workerIndex] = scatterPart(random, true, thisWorkerCausticPhotonsEnd - thisWorkerCausticPhotonsBegin, scatteredCausticPhotons);
+        } else if (m_mapLevelsBuilt < mapLevelCount()) {
+            PHOTON_MAPPING_TRACE_SCOPE(QString("photon map level %1").arg(m_mapLevelsBuilt));
+            int subtreeCount = (m_mapLevelsBuilt < m_photonMap.levelCount()) ? PhotonMap::subtreeCountAtLevel(m_mapLevelsBuilt) : 0;
+            int causticSubtreeCount = (m_mapLevelsBuilt < m_causticPhotonMap.levelCount()) ? PhotonMap::subtreeCountAtLevel(m_mapLevelsBuilt) : 0;
+            int thisWorkerSubtreesBegin, thisWorkerSubtreesEnd;
+            partition(subtreeCount + causticSubtreeCount, workerCount(), workerIndex, thisWorkerSubtreesBegin, thisWorkerSubtreesEnd);
             for (int subtree = thisWorkerSubtreesBegin; subtree < thisWorkerSubtreesEnd; ++subtree) {
                 checkInterrupts();
-                m_photonMap.buildLevelOnSubtree(m_mapLevelsBuilt, subtree);
+                if (subtree < subtreeCount) {
+                    m_photonMap.buildLevelOnSubtree(m_mapLevelsBuilt, subtree);
+                } else {
+                    m_causticPhotonMap.buildLevelOnSubtree(m_mapLevelsBuilt, subtree - subtreeCount);
+                }
+            }
+        } else {
+            PHOTON_MAPPING_TRACE_SCOPE(QString("render quality %1").arg(m_quality));
+            std::vector<int> tiles = scheduledTiles();
+            int tileIndex;
+            while ((tileIndex = m_nextTile.fetchAndAddRelaxed(1)) < int(tiles.size())) {
+                int tile = tiles[tileIndex];
+                Segment2i segment = tileSegment(tile);
+                m_surface->saveTileSamples(segment, m_tileSamples[workerIndex]);
+                m_tilesInProgress[workerIndex] = tile;
+                IrradianceCache& tileIrradianceCache = *m_tileIrradianceCaches[workerIndex];
+                tileIrradianceCache.reset(m_irradianceCache);
+                int sampledPixelCount = renderPart(m_nearestPhotonBuffers[workerIndex], tileIrradianceCache, segment, tileQuality(tile));
+                m_tilesInProgress[workerIndex] = -1;
+                m_renderedTiles[workerIndex].push_back(RenderedTile());
+                RenderedTile& renderedTile = m_renderedTiles[workerIndex].back();
+                renderedTile.tile = tile;
+                renderedTile.sampledPixelCount = sampledPixelCount;
+                renderedTile.irradianceRecords = tileIrradianceCache.records();
+                m_surface->commitTile(segment);
             }
-            return;
         }
-        Extent2i sufraceExtent = m_surface->extent();
-        int lineCount = sufraceExtent.y;
-        int lineCountPerWorker = lineCount / workerCount();
-        int leftoverLineCount = lineCount - lineCountPerWorker * workerCount();
-        int thisWorkerLineBegin = lineCountPerWorker * (workerIndex + 0) + min(workerIndex + 0, leftoverLineCount);
-        int thisWorkerLineEnd = lineCountPerWorker * (workerIndex + 1) + min(workerIndex + 1, leftoverLineCount);
-        Segment2i segment = Segment2i(
-            Point2i(0, thisWorkerLineBegin),
-            Point2i(sufraceExtent.x, thisWorkerLineEnd)
-        );
-        renderPart(m_nearestPhotonBuffers[workerIndex], segment);
+        m_taskPartNsecs[workerIndex] = taskPartTimer.nsecsElapsed();
+        m_taskPartCounters[workerIndex] = taskPartCounters;
     }
 
     void RendererBase::taskDone() {
+        m_nextTile.store(0);
+        PhaseStatistics taskStatistics;
+        taskStatistics.workers.resize(workerCount());
+        for (int workerIndex = 0; workerIndex < workerCount(); ++workerIndex) {
+            WorkerStatistics& workerStatistics = taskStatistics.workers[workerIndex];
+            workerStatistics.nsecs = m_taskPartNsecs[workerIndex];
+            workerStatistics.barrierWaitNsecs = barrierWaitNsecs(workerIndex);
+            workerStatistics.counters = m_taskPartCounters[workerIndex];
+            taskStatistics.nsecs = max(taskStatistics.nsecs, workerStatistics.nsecs);
+            taskStatistics.counters += workerStatistics.counters;
+        }
+        QMutexLocker statisticsGuardLocker(&m_statisticsGuard);
         if (!m_photonsScattered) {
+            m_statistics.scatter = taskStatistics;
+            merge(m_photons, m_scatteredPhotonBuffers);
+            merge(m_causticPhotons, m_scatteredCausticPhotonBuffers);
+            m_emittedPhotonCount = 0;
+            m_emittedCausticPhotonCount = 0;
+            for (int workerIndex = 0; workerIndex < workerCount(); ++workerIndex) {
+                m_emittedPhotonCount += m_emittedPhotonCounts[workerIndex];
+                m_emittedCausticPhotonCount += m_emittedCausticPhotonCounts[workerIndex];
+            }
             m_photonsScattered = true;
             return;
         }
-        if (m_mapLevelsBuilt < m_photonMap.levelCount()) {
+        if (m_mapLevelsBuilt < mapLevelCount()) {
+            accumulate(m_statistics.mapBuild, taskStatistics);
             ++m_mapLevelsBuilt;
             return;
         }
         if (m_quality < m_finalQuality) {
-            if (m_quality == 0) {
-                qDebug() << m_surface->extent().x << "x" << m_surface->extent().y << "=" << (m_surface->extent().x * m_surface->extent().y) << ":" << (m_elapsedTimer.nsecsElapsed() / 1e9);
-            }
-            m_surface->commitUpdate();
-            ++m_quality;
+            accumulate(m_statistics.render[advanceRenderedTiles()], taskStatistics);
             return;
         }
     }
 
     void RendererBase::taskAborted() {
-        //m_elapsedTimer.restart();
+        m_nextTile.store(0);
+        for (int workerIndex = 0; workerIndex < workerCount(); ++workerIndex) {
+            int tile = m_tilesInProgress[workerIndex];
+            if (tile >= 0) {
+                Segment2i segment = tileSegment(tile);
+                m_surface->restoreTileSamples(segment, m_tileSamples[workerIndex]);
+                m_surface->commitTile(segment);
+                m_tilesInProgress[workerIndex] = -1;
+            }
+        }
+        if (m_photonsScattered && m_mapLevelsBuilt == mapLevelCount()) {
+            advanceRenderedTiles();
+        }
+    }
+
+    int RendererBase::mapLevelCount() const {
+        return max(m_photonMap.levelCount(), m_causticPhotonMap.levelCount());
+    }
+
+    void RendererBase::resizeNearestPhotonBuffers() {
+        for (auto& nearestPhotonBuffer : m_nearestPhotonBuffers) {
+            nearestPhotonBuffer.resize(max(m_photonGatherCount, m_causticPhotonGatherCount));
+            nearestPhotonBuffer.shrink_to_fit();
+        }
+    }
+
+    Extent2i RendererBase::tileCount() const {
+        Extent2i sufraceExtent = m_surface->extent();
+        return Extent2i(
+            (sufraceExtent.x + TILE_SIZE - 1) / TILE_SIZE,
+            (sufraceExtent.y + TILE_SIZE - 1) / TILE_SIZE
+        );
+    }
+
+    Segment2i RendererBase::tileSegment(int tile) const {
+        Extent2i sufraceExtent = m_surface->extent();
+        Extent2i tileCount = this->tileCount();
+        Point2i tilePosition = Point2i(tile % tileCount.x, tileCount.y - 1 - tile / tileCount.x);
+        return Segment2i(
+            Point2i(tilePosition.x * TILE_SIZE, tilePosition.y * TILE_SIZE),
+            Point2i(min((tilePosition.x + 1) * TILE_SIZE, sufraceExtent.x), min((tilePosition.y + 1) * TILE_SIZE, sufraceExtent.y))
+        );
+    }
+
+    int RendererBase::tileQuality(int tile) const {
+        return (tile < int(m_tileQualities.size())) ? m_tileQualities[tile] : m_quality;
+    }
+
+    bool RendererBase::isPriorityTile(int tile) const {
+        if (!m_hasPriorityRegion) {
+            return false;
+        }
+        Segment2i segment = tileSegment(tile);
+        return segment.min.x < m_priorityRegion.max.x && m_priorityRegion.min.x < segment.max.x
+            && segment.min.y < m_priorityRegion.max.y && m_priorityRegion.min.y < segment.max.y;
+    }
+
+    std::vector<int> RendererBase::scheduledTiles() const {
+        Extent2i tileCount = this->tileCount();
+        int totalTileCount = tileCount.x * tileCount.y;
+        int frameQuality = m_finalQuality;
+        for (int tile = 0; tile < totalTileCount; ++tile) {
+            frameQuality = min(frameQuality, tileQuality(tile));
+        }
+        bool refinePriorityTiles = false;
+        if (frameQuality > m_initialQuality) {
+            for (int tile = 0; tile < totalTileCount; ++tile) {
+                if (isPriorityTile(tile) && tileQuality(tile) < m_finalQuality) {
+                    refinePriorityTiles = true;
+                    break;
+                }
+            }
+        }
+        std::vector<int> priorityTiles;
+        std::vector<int> otherTiles;
+        for (int tile = 0; tile < totalTileCount; ++tile) {
+            int quality = tileQuality(tile);
+            if (isPriorityTile(tile)) {
+                if (refinePriorityTiles ? quality < m_finalQuality : quality == frameQuality) {
+                    priorityTiles.push_back(tile);
+                }
+            } else if (!refinePriorityTiles && quality == frameQuality) {
+                otherTiles.push_back(tile);
+            }
+        }
+        priorityTiles.insert(priorityTiles.end(), otherTiles.begin(), otherTiles.end());
+        return priorityTiles;
+    }
+
+    void RendererBase::clearTileQualities() {
+        m_tileQualities.clear();
+        for (auto& renderedTiles : m_renderedTiles) {
+            renderedTiles.clear();
+        }
+    }
+
+    int RendererBase::advanceRenderedTiles() {
+        Extent2i tileCount = this->tileCount();
+        m_tileQualities.resize(tileCount.x * tileCount.y, m_quality);
+        std::vector<RenderedTile const*> renderedTilesInOrder;
+        for (auto const& renderedTiles : m_renderedTiles) {
+            for (auto const& renderedTile : renderedTiles) {
+                renderedTilesInOrder.push_back(&renderedTile);
+            }
+        }
+        std::sort(renderedTilesInOrder.begin(), renderedTilesInOrder.end(), [](RenderedTile const* a, RenderedTile const* b) {
+            return a->tile < b->tile;
+        });
+        int taskQuality = m_finalQuality;
+        for (auto renderedTile : renderedTilesInOrder) {
+            m_irradianceCache.insert(renderedTile->irradianceRecords);
+            int& quality = m_tileQualities[renderedTile->tile];
+            taskQuality = min(taskQuality, quality);
+            quality = (renderedTile->sampledPixelCount == 0) ? m_finalQuality : quality + 1;
+        }
+        for (auto& renderedTiles : m_renderedTiles) {
+            renderedTiles.clear();
+        }
+        if (!m_tileQualities.empty()) {
+            m_quality = *std::min_element(m_tileQualities.begin(), m_tileQualities.end());
+        }
+        return taskQuality;
     }
-}
\ No newline at end of file
+}
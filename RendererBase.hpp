@@ -1,10 +1,13 @@
 #ifndef PHOTON_MAPPING_RENDERER_BASE_HPP
 #define PHOTON_MAPPING_RENDERER_BASE_HPP
 
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include <map>
 
-#include <QElapsedTimer>
+#include <QMutex>
+#include <QAtomicInt>
 
 #include "WorkerSet.hpp"
 #include "Scene.hpp"
@@ -13,6 +16,8 @@
 #include "Random.hpp"
 #include "Photon.hpp"
 #include "PhotonMap.hpp"
+#include "IrradianceCache.hpp"
+#include "Counters.hpp"
 
 namespace photon_mapping {
     class RendererBase
@@ -20,6 +25,30 @@ namespace photon_mapping {
     {
         Q_OBJECT
         public:
+            struct WorkerStatistics {
+                qint64 nsecs;
+                qint64 barrierWaitNsecs;
+                Counters counters;
+
+                WorkerStatistics();
+            };
+
+            struct PhaseStatistics {
+                qint64 nsecs;
+                Counters counters;
+                std::vector<WorkerStatistics> workers;
+
+                PhaseStatistics();
+            };
+
+            struct Statistics {
+                PhaseStatistics scatter;
+                PhaseStatistics mapBuild;
+                std::map<int, PhaseStatistics> render;
+            };
+
+            static int const TILE_SIZE = 32;
+
             RendererBase();
         
             std::shared_ptr<Scene> const& scene() const;
@@ -39,6 +68,24 @@ namespace photon_mapping {
             int photonGatherCount() const;
             void setPhotonGatherCount(int photonGatherCount);
 
+            float photonGatherRadius() const;
+            void setPhotonGatherRadius(float photonGatherRadius);
+
+            int causticPhotonCount() const;
+            void setCausticPhotonCount(int causticPhotonCount);
+
+            int causticPhotonGatherCount() const;
+            void setCausticPhotonGatherCount(int causticPhotonGatherCount);
+
+            float causticPhotonGatherRadius() const;
+            void setCausticPhotonGatherRadius(float causticPhotonGatherRadius);
+
+            int finalGatherRayCount() const;
+            void setFinalGatherRayCount(int finalGatherRayCount);
+
+            float irradianceCacheMaxError() const;
+            void setIrradianceCacheMaxError(float irradianceCacheMaxError);
+
             int initialQuality() const;
             void setInitialQuality(int initialQuality);
 
@@ -51,11 +98,28 @@ namespace photon_mapping {
             int maxRayBounceCount() const;
             void setMaxRayBounceCount(int maxRayBounceCount);
 
+            float adaptiveThreshold() const;
+            void setAdaptiveThreshold(float adaptiveThreshold);
+
+            std::uint32_t seed() const;
+            void setSeed(std::uint32_t seed);
+
+            bool hasPriorityRegion() const;
+            Segment2i const& priorityRegion() const;
+            void setPriorityRegion(Segment2i const& priorityRegion);
+            void clearPriorityRegion();
+
+            Statistics statistics() const;
+
         protected:
             PhotonMap const& photonMap() const;
+            int emittedPhotonCount() const;
+            PhotonMap const& causticPhotonMap() const;
+            int emittedCausticPhotonCount() const;
+            IrradianceCache const& irradianceCache() const;
 
-            virtual void scatterPart(Random& random, std::vector<Photon>::iterator begin, std::vector<Photon>::iterator end) = 0;
-            virtual void renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, Segment2i const& segment) = 0;
+            virtual int scatterPart(Random& random, bool caustic, int photonCount, std::vector<Photon>& photons) = 0;
+            virtual int renderPart(std::vector<PhotonMap::NearestPhoton>& nearestPhotons, IrradianceCache& tileIrradianceCache, Segment2i const& segment, int quality) = 0;
 
             virtual bool nextTask();
             virtual void doTaskPart(int workerIndex);
@@ -63,20 +127,65 @@ namespace photon_mapping {
             virtual void taskAborted();
 
         private:
+            struct RenderedTile {
+                int tile;
+                int sampledPixelCount;
+                std::vector<IrradianceCache::Record> irradianceRecords;
+            };
+
             std::shared_ptr<Scene> m_scene;
             std::shared_ptr<Camera> m_camera;
             std::shared_ptr<Surface> m_surface;
             
+            int m_photonCount;
+            int m_photonGatherCount;
+            float m_photonGatherRadius;
             std::vector<Photon> m_photons;
+            int m_emittedPhotonCount;
+            PhotonMap m_photonMap;
+            int m_causticPhotonCount;
+            int m_causticPhotonGatherCount;
+            float m_causticPhotonGatherRadius;
+            std::vector<Photon> m_causticPhotons;
+            int m_emittedCausticPhotonCount;
+            PhotonMap m_causticPhotonMap;
             bool m_photonsScattered;
             int m_mapLevelsBuilt;
-            PhotonMap m_photonMap;
+            std::vector<std::vector<Photon>> m_scatteredPhotonBuffers;
+            std::vector<int> m_emittedPhotonCounts;
+            std::vector<std::vector<Photon>> m_scatteredCausticPhotonBuffers;
+            std::vector<int> m_emittedCausticPhotonCounts;
             std::vector<std::vector<PhotonMap::NearestPhoton>> m_nearestPhotonBuffers;
+            int m_finalGatherRayCount;
+            IrradianceCache m_irradianceCache;
+            std::vector<std::unique_ptr<IrradianceCache>> m_tileIrradianceCaches;
             int m_initialQuality;
             int m_quality;
             int m_finalQuality;
             int m_maxRayBounceCount;
-            QElapsedTimer m_elapsedTimer;
+            float m_adaptiveThreshold;
+            std::uint32_t m_seed;
+            bool m_hasPriorityRegion;
+            Segment2i m_priorityRegion;
+            std::vector<int> m_tileQualities;
+            QAtomicInt m_nextTile;
+            std::vector<std::vector<RenderedTile>> m_renderedTiles;
+            std::vector<int> m_tilesInProgress;
+            std::vector<Surface::TileSamples> m_tileSamples;
+            std::vector<qint64> m_taskPartNsecs;
+            std::vector<Counters> m_taskPartCounters;
+            Statistics m_statistics;
+            mutable QMutex m_statisticsGuard;
+
+            int mapLevelCount() const;
+            void resizeNearestPhotonBuffers();
+            Extent2i tileCount() const;
+            Segment2i tileSegment(int tile) const;
+            int tileQuality(int tile) const;
+            bool isPriorityTile(int tile) const;
+            std::vector<int> scheduledTiles() const;
+            int advanceRenderedTiles();
+            void clearTileQualities();
     };
 }
 
@@ -12,17 +12,57 @@ namespace photon_mapping {
     }
 
     inline int RendererBase::photonCount() const {
-        return m_photons.size();
+        return m_photonCount;
     }
 
     inline int RendererBase::photonGatherCount() const {
-        return m_nearestPhotonBuffers[0].size();
+        return m_photonGatherCount;
+    }
+
+    inline float RendererBase::photonGatherRadius() const {
+        return m_photonGatherRadius;
+    }
+
+    inline int RendererBase::causticPhotonCount() const {
+        return m_causticPhotonCount;
+    }
+
+    inline int RendererBase::causticPhotonGatherCount() const {
+        return m_causticPhotonGatherCount;
+    }
+
+    inline float RendererBase::causticPhotonGatherRadius() const {
+        return m_causticPhotonGatherRadius;
     }
 
     inline PhotonMap const& RendererBase::photonMap() const {
         return m_photonMap;
     }
 
+    inline int RendererBase::emittedPhotonCount() const {
+        return m_emittedPhotonCount;
+    }
+
+    inline PhotonMap const& RendererBase::causticPhotonMap() const {
+        return m_causticPhotonMap;
+    }
+
+    inline int RendererBase::emittedCausticPhotonCount() const {
+        return m_emittedCausticPhotonCount;
+    }
+
+    inline int RendererBase::finalGatherRayCount() const {
+        return m_finalGatherRayCount;
+    }
+
+    inline float RendererBase::irradianceCacheMaxError() const {
+        return m_irradianceCache.maxError();
+    }
+
+    inline IrradianceCache const& RendererBase::irradianceCache() const {
+        return m_irradianceCache;
+    }
+
     inline int RendererBase::initialQuality() const {
         return m_initialQuality;
     }
@@ -38,4 +78,20 @@ namespace photon_mapping {
     inline int RendererBase::maxRayBounceCount() const {
         return m_maxRayBounceCount;
     }
+
+    inline float RendererBase::adaptiveThreshold() const {
+        return m_adaptiveThreshold;
+    }
+
+    inline std::uint32_t RendererBase::seed() const {
+        return m_seed;
+    }
+
+    inline bool RendererBase::hasPriorityRegion() const {
+        return m_hasPriorityRegion;
+    }
+
+    inline Segment2i const& RendererBase::priorityRegion() const {
+        return m_priorityRegion;
+    }
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 namespace photon_mapping {
     Scene::Scene()
-        : m_boundingIntervalHierarchy(m_objects.begin(), m_objects.end())
+        : m_hasSpecularMaterial(false)
+        , m_emitterArea(0.0f)
+        , m_boundingIntervalHierarchy(m_objects.begin(), m_objects.end())
     {}
 
     bool Scene::empty() const {
@@ -19,14 +21,40 @@ namespace photon_mapping {
 
     void Scene::invalidate() {
         m_inclusiveCumulativeObjectProbabilities.clear();
+        m_hasSpecularMaterial = false;
+        m_emitters.clear();
+        m_inclusiveCumulativeEmitterProbabilities.clear();
+        m_emitterArea = 0.0f;
         float area = 0.0f;
-        for (auto& object : m_objects) {
-            area += object->area();
+        for (auto object = m_objects.cbegin(); object != m_objects.cend(); ++object) {
+            area += (*object)->area();
             m_inclusiveCumulativeObjectProbabilities.push_back(area); 
+            for (int materialIndex = 0; materialIndex < (*object)->materialCount(); ++materialIndex) {
+                m_hasSpecularMaterial = m_hasSpecularMaterial || (*object)->material(materialIndex)->isSpecular();
+            }
+            Mesh const& mesh = *(*object)->mesh();
+            for (int triangleIndex = 0; triangleIndex < mesh.triangles().size(); ++triangleIndex) {
+                if (!(*object)->material(mesh.triangleAttributes()[triangleIndex].materialIndex)->isEmissive()) {
+                    continue;
+                }
+                Mesh::Triangle const& triangle = mesh.triangles()[triangleIndex];
+                float triangleArea = length(cross(triangle.edge01 * (*object)->transformation(), triangle.edge02 * (*object)->transformation())) / 2.0f;
+                if (triangleArea > 0.0f) {
+                    Emitter emitter;
+                    emitter.object = object;
+                    emitter.triangle = triangleIndex;
+                    m_emitters.push_back(emitter);
+                    m_emitterArea += triangleArea;
+                    m_inclusiveCumulativeEmitterProbabilities.push_back(m_emitterArea);
+                }
+            }
         }
         for (auto& m_inclusiveCumulativeObjectProbability : m_inclusiveCumulativeObjectProbabilities) {
             m_inclusiveCumulativeObjectProbability /= area;
         }
+        for (auto& inclusiveCumulativeEmitterProbability : m_inclusiveCumulativeEmitterProbabilities) {
+            inclusiveCumulativeEmitterProbability /= m_emitterArea;
+        }
         m_boundingIntervalHierarchy.rebuild(m_objects.begin(), m_objects.end());
     }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "Object.hpp"
+#include "Counters.hpp"
 
 namespace photon_mapping {
     class Scene {
@@ -13,6 +14,10 @@ namespace photon_mapping {
                 std::vector<std::shared_ptr<Object>>::const_iterator object;
             };
 
+            struct Hit : Object::Hit {
+                std::vector<std::shared_ptr<Object>>::const_iterator object;
+            };
+
             Scene();
 
             bool empty() const;
@@ -20,13 +25,29 @@ namespace photon_mapping {
             void clear();
 
             void invalidate();
+            Segment3f bound() const;
+            bool hasSpecularMaterial() const;
+            bool hasEmitter() const;
+            float emitterArea() const;
 
             Sample uniformOnSurface(Random& random) const;
+            Sample uniformOnEmitter(Point2f const& u) const;
+            bool hit(Ray const& ray, float& hitDistance, Hit& hit) const;
             bool hit(Ray const& ray, float& hitDistance, Sample& hit) const;
+            Sample shade(Ray const& ray, Hit const& hit) const;
 
         private:
+            struct Emitter {
+                std::vector<std::shared_ptr<Object>>::const_iterator object;
+                int triangle;
+            };
+
             std::vector<std::shared_ptr<Object>> m_objects;
             std::vector<float> m_inclusiveCumulativeObjectProbabilities;
+            bool m_hasSpecularMaterial;
+            std::vector<Emitter> m_emitters;
+            std::vector<float> m_inclusiveCumulativeEmitterProbabilities;
+            float m_emitterArea;
             BoundingIntervalHierarchy<std::shared_ptr<Object>, std::vector<std::shared_ptr<Object>>::const_iterator> m_boundingIntervalHierarchy;
     };
 }
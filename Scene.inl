@@ -1,4 +1,20 @@
 namespace photon_mapping {
+    inline Segment3f Scene::bound() const {
+        return m_boundingIntervalHierarchy.bound();
+    }
+
+    inline bool Scene::hasSpecularMaterial() const {
+        return m_hasSpecularMaterial;
+    }
+
+    inline bool Scene::hasEmitter() const {
+        return !m_emitters.empty();
+    }
+
+    inline float Scene::emitterArea() const {
+        return m_emitterArea;
+    }
+
     inline Scene::Sample Scene::uniformOnSurface(Random& random) const {
         int objectIndex = std::lower_bound(m_inclusiveCumulativeObjectProbabilities.begin(), m_inclusiveCumulativeObjectProbabilities.end(), random.uniformInRange01()) - m_inclusiveCumulativeObjectProbabilities.begin();
         auto object = m_objects.begin() + objectIndex;  
@@ -8,7 +24,36 @@ namespace photon_mapping {
         return sample;
     }
 
-    inline bool Scene::hit(Ray const& ray, float& hitDistance, Sample& hit) const {
+    inline Scene::Sample Scene::uniformOnEmitter(Point2f const& u) const {
+        int emitterIndex = std::lower_bound(m_inclusiveCumulativeEmitterProbabilities.begin(), m_inclusiveCumulativeEmitterProbabilities.end(), u.x) - m_inclusiveCumulativeEmitterProbabilities.begin();
+        emitterIndex = min(emitterIndex, int(m_emitters.size()) - 1);
+        float probabilityBegin = (emitterIndex > 0) ? m_inclusiveCumulativeEmitterProbabilities[emitterIndex - 1] : 0.0f;
+        float probabilityEnd = m_inclusiveCumulativeEmitterProbabilities[emitterIndex];
+        Emitter const& emitter = m_emitters[emitterIndex];
+        Sample sample;
+        static_cast<Object::Sample&>(sample) = (*emitter.object)->onTriangle(emitter.triangle, Point2f(clamp(0.0f, (u.x - probabilityBegin) / (probabilityEnd - probabilityBegin), 1.0f), u.y));
+        sample.object = emitter.object;
+        return sample;
+    }
+
+    inline bool Scene::hit(Ray const& ray, float& hitDistance, Hit& hit) const {
+        PHOTON_MAPPING_COUNT(raysTraced, 1);
         return m_boundingIntervalHierarchy.hit(ray, hitDistance, hit, hit.object);
     }
+
+    inline bool Scene::hit(Ray const& ray, float& hitDistance, Sample& hit) const {
+        Hit lazyHit;
+        if (!this->hit(ray, hitDistance, lazyHit)) {
+            return false;
+        }
+        hit = shade(ray, lazyHit);
+        return true;
+    }
+
+    inline Scene::Sample Scene::shade(Ray const& ray, Hit const& hit) const {
+        Sample sample;
+        static_cast<Object::Sample&>(sample) = (*hit.object)->shade(ray, hit);
+        sample.object = hit.object;
+        return sample;
+    }
 }
\ No newline at end of file
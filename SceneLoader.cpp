@@ -0,0 +1,86 @@
+#include "SceneLoader.hpp"
+
+#include <QMutexLocker>
+
+#include "Trace.hpp"
+
+namespace photon_mapping {
+    SceneLoader::SceneLoader()
+        : m_abortRequested(false)
+        , m_progressPending(false)
+    {
+        connect(this, &SceneLoader::progressPosted, this, &SceneLoader::progressed, Qt::QueuedConnection);
+    }
+
+    SceneLoader::~SceneLoader() {
+        abort();
+    }
+
+    void SceneLoader::load(QString const& objFilePath) {
+        abort();
+        m_objFilePath = objFilePath;
+        m_abortRequested.store(false);
+        start();
+    }
+
+    void SceneLoader::abort() {
+        m_abortRequested.store(true);
+        wait();
+        QMutexLocker guardLocker(&m_guard);
+        m_loadedObjects.clear();
+        m_textureAssignments.clear();
+        m_progressPending = false;
+    }
+
+    bool SceneLoader::commit(Scene& scene) {
+        QMutexLocker guardLocker(&m_guard);
+        bool changed = !m_loadedObjects.empty() || !m_textureAssignments.empty();
+        for (auto const& object : m_loadedObjects) {
+            scene.addObject(object);
+        }
+        for (auto const& assignTextures : m_textureAssignments) {
+            assignTextures();
+        }
+        m_loadedObjects.clear();
+        m_textureAssignments.clear();
+        m_progressPending = false;
+        return changed;
+    }
+
+    void SceneLoader::run() {
+        PHOTON_MAPPING_TRACE_THREAD_NAME("scene loader");
+        loadObj(*this, m_objFilePath);
+    }
+
+    bool SceneLoader::isAborted() const {
+        return m_abortRequested.load();
+    }
+
+    void SceneLoader::objectLoaded(std::shared_ptr<Object> const& object) {
+        m_guard.lock();
+        m_loadedObjects.push_back(object);
+        bool postProgress = setProgressPending();
+        m_guard.unlock();
+        if (postProgress) {
+            emit progressPosted();
+        }
+    }
+
+    void SceneLoader::texturesLoaded(std::function<void()> const& assignTextures) {
+        m_guard.lock();
+        m_textureAssignments.push_back(assignTextures);
+        bool postProgress = setProgressPending();
+        m_guard.unlock();
+        if (postProgress) {
+            emit progressPosted();
+        }
+    }
+
+    bool SceneLoader::setProgressPending() {
+        if (m_progressPending) {
+            return false;
+        }
+        m_progressPending = true;
+        return true;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PHOTON_MAPPING_SCENE_LOADER_HPP
+#define PHOTON_MAPPING_SCENE_LOADER_HPP
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QString>
+
+#include "Scene.hpp"
+#include "loadObj.hpp"
+
+namespace photon_mapping {
+    class SceneLoader
+        : public QThread
+        , private LoadObjListener
+    {
+        Q_OBJECT
+        public:
+            SceneLoader();
+            virtual ~SceneLoader();
+
+            void load(QString const& objFilePath);
+            void abort();
+
+            bool commit(Scene& scene);
+
+        signals:
+            void progressed();
+            void progressPosted();
+
+        protected:
+            virtual void run();
+
+        private:
+            QString m_objFilePath;
+            QAtomicInt m_abortRequested;
+            QMutex m_guard;
+            std::vector<std::shared_ptr<Object>> m_loadedObjects;
+            std::vector<std::function<void()>> m_textureAssignments;
+            bool m_progressPending;
+
+            virtual bool isAborted() const;
+            virtual void objectLoaded(std::shared_ptr<Object> const& object);
+            virtual void texturesLoaded(std::function<void()> const& assignTextures);
+            bool setProgressPending();
+    };
+}
+
+#endif
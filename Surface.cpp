@@ -1,37 +1,114 @@
 #include "Surface.hpp"
 
+#include <cstring>
+
 #include <QScreen>
+#include <QMutexLocker>
+
+#include "Trace.hpp"
 
 namespace photon_mapping {
+    namespace {
+        int const CACHE_LINE_SIZE = 64;
+        int const PIXELS_PER_CACHE_LINE = CACHE_LINE_SIZE / sizeof(QRgb);
+
+        QRgb* allocatePixels(int pixelStride, int height) {
+            std::size_t size = std::size_t(pixelStride) * height * sizeof(QRgb);
+            QRgb* pixels = static_cast<QRgb*>(qMallocAligned(size, CACHE_LINE_SIZE));
+            std::memset(pixels, 0, size);
+            return pixels;
+        }
+    }
+
     Surface::Surface()
         : m_extent(Extent2i(1, 1))
-        , m_foreground()
-        , m_background(m_extent.x, m_extent.y, QImage::Format_RGB32)
-        , m_valid(true)
+        , m_radianceSums(m_extent.x * m_extent.y, Color::BLACK)
+        , m_sqrLuminanceSums(m_extent.x * m_extent.y, 0.0f)
+        , m_sampleCounts(m_extent.x * m_extent.y, 0.0f)
+        , m_depths(m_extent.x * m_extent.y, inf())
+        , m_normals(m_extent.x * m_extent.y, Vector3f::ZERO)
+        , m_pixelStride(PIXELS_PER_CACHE_LINE)
+        , m_foreground(allocatePixels(m_pixelStride, m_extent.y))
+        , m_background(allocatePixels(m_pixelStride, m_extent.y))
     {
         connect(&m_updateEmitter, &QTimer::timeout, [this]{
             m_guard.lock();
-            if (!m_valid) {
-                emit imageUpdated(m_foreground);
-                m_foreground.detach();
-                m_valid = true;
+            if (!m_dirtyRect.isEmpty()) {
+                emit imageUpdated(foregroundImage(), m_dirtyRect);
+                m_dirtyRect = QRect();
             }
             m_guard.unlock();
         });
         m_updateEmitter.start((1.0 / 60.0) * 1000);
     }
 
+    Surface::~Surface() {
+        qFreeAligned(m_foreground);
+        qFreeAligned(m_background);
+    }
+
     void Surface::setExtent(Extent2i const& extent) {
         m_extent = extent;
-        m_foreground = QImage(m_extent.x, m_extent.y, QImage::Format_RGB32);
-        m_background = QImage(m_extent.x, m_extent.y, QImage::Format_RGB32);
+        m_radianceSums.assign(m_extent.x * m_extent.y, Color::BLACK);
+        m_sqrLuminanceSums.assign(m_extent.x * m_extent.y, 0.0f);
+        m_sampleCounts.assign(m_extent.x * m_extent.y, 0.0f);
+        m_depths.assign(m_extent.x * m_extent.y, inf());
+        m_normals.assign(m_extent.x * m_extent.y, Vector3f::ZERO);
+        m_pixelStride = (m_extent.x + PIXELS_PER_CACHE_LINE - 1) / PIXELS_PER_CACHE_LINE * PIXELS_PER_CACHE_LINE;
+        QMutexLocker guardLocker(&m_guard);
+        qFreeAligned(m_foreground);
+        qFreeAligned(m_background);
+        m_foreground = allocatePixels(m_pixelStride, m_extent.y);
+        m_background = allocatePixels(m_pixelStride, m_extent.y);
+        m_dirtyRect = QRect();
+    }
+
+    void Surface::commitTile(Segment2i const& tile) {
+        PHOTON_MAPPING_TRACE_SCOPE("commit tile");
+        QRect tileRect(tile.min.x, m_extent.y - tile.max.y, tile.max.x - tile.min.x, tile.max.y - tile.min.y);
+        std::size_t rowSize = tileRect.width() * sizeof(QRgb);
+        // other workers are still writing their tiles into the background, so only this tile can be published
+        QMutexLocker guardLocker(&m_guard);
+        for (int y = tileRect.top(); y <= tileRect.bottom(); ++y) {
+            std::size_t rowOffset = std::size_t(y) * m_pixelStride + tileRect.left();
+            std::memcpy(m_foreground + rowOffset, m_background + rowOffset, rowSize);
+        }
+        m_dirtyRect |= tileRect;
+    }
+
+    void Surface::saveTileSamples(Segment2i const& tile, TileSamples& samples) const {
+        samples.radianceSums.clear();
+        samples.sqrLuminanceSums.clear();
+        samples.sampleCounts.clear();
+        for (int y = tile.min.y; y < tile.max.y; ++y) {
+            std::size_t rowOffset = std::size_t(y) * m_extent.x;
+            samples.radianceSums.insert(samples.radianceSums.end(), m_radianceSums.begin() + rowOffset + tile.min.x, m_radianceSums.begin() + rowOffset + tile.max.x);
+            samples.sqrLuminanceSums.insert(samples.sqrLuminanceSums.end(), m_sqrLuminanceSums.begin() + rowOffset + tile.min.x, m_sqrLuminanceSums.begin() + rowOffset + tile.max.x);
+            samples.sampleCounts.insert(samples.sampleCounts.end(), m_sampleCounts.begin() + rowOffset + tile.min.x, m_sampleCounts.begin() + rowOffset + tile.max.x);
+        }
+    }
+
+    void Surface::restoreTileSamples(Segment2i const& tile, TileSamples const& samples) {
+        int sample = 0;
+        for (int y = tile.min.y; y < tile.max.y; ++y) {
+            Row row = this->row(y);
+            for (int x = tile.min.x; x < tile.max.x; ++x, ++sample) {
+                row.m_radianceSums[x] = samples.radianceSums[sample];
+                row.m_sqrLuminanceSums[x] = samples.sqrLuminanceSums[sample];
+                row.m_sampleCounts[x] = samples.sampleCounts[sample];
+                if (row.m_sampleCounts[x] > 0.0f) {
+                    row.m_pixels[x] = tonemap(row.m_radianceSums[x] / row.m_sampleCounts[x]);
+                }
+            }
+        }
+    }
+
+    QImage Surface::image() const {
+        QMutexLocker guardLocker(&m_guard);
+        return foregroundImage().copy();
     }
 
-    void Surface::commitUpdate() {
-        m_guard.lock();
-        m_foreground = m_background;
-        m_background.detach();
-        m_valid = false;
-        m_guard.unlock();
+    QImage Surface::foregroundImage() const {
+        return QImage(reinterpret_cast<uchar const*>(m_foreground), m_extent.x, m_extent.y, m_pixelStride * sizeof(QRgb), QImage::Format_RGB32);
     }
-}
\ No newline at end of file
+}
@@ -2,15 +2,19 @@
 #define PHOTON_MAPPING_SURFACE_HPP
 
 #include <memory>
+#include <vector>
 
 #include <QObject>
 #include <QImage>
 #include <QMutex>
 #include <QTimer>
+#include <QRect>
 
 #include "Extent.hpp"
 #include "Color.hpp"
 #include "Point.hpp"
+#include "Vector.hpp"
+#include "Segment.hpp"
 
 namespace photon_mapping {
     class Surface
@@ -18,27 +22,74 @@ namespace photon_mapping {
     {
         Q_OBJECT
         public:
+            class Row {
+                public:
+                    void setPixel(int x, Color const& color);
+                    void setSamples(int x, Color const& radianceSum, float sqrLuminanceSum, int sampleCount);
+                    void addSamples(int x, Color const& radianceSum, float sqrLuminanceSum, int sampleCount);
+                    float relativeError(int x) const;
+                    Color radiance(int x) const;
+
+                    void setGeometry(int x, float depth, Vector3f const& normal);
+                    float depth(int x) const;
+                    Vector3f const& normal(int x) const;
+
+                private:
+                    friend class Surface;
+
+                    Color* m_radianceSums;
+                    float* m_sqrLuminanceSums;
+                    float* m_sampleCounts;
+                    float* m_depths;
+                    Vector3f* m_normals;
+                    QRgb* m_pixels;
+
+                    Row(Color* radianceSums, float* sqrLuminanceSums, float* sampleCounts, float* depths, Vector3f* normals, QRgb* pixels);
+            };
+
+            struct TileSamples {
+                std::vector<Color> radianceSums;
+                std::vector<float> sqrLuminanceSums;
+                std::vector<float> sampleCounts;
+            };
+
             Surface();
+            virtual ~Surface();
 
             Extent2i extent() const;
             void setExtent(Extent2i const& extent);
 
+            Row row(int y);
             void setPixel(Point2i const& position, Color const& color);
-            void commitUpdate();
+            void commitTile(Segment2i const& tile);
+            void saveTileSamples(Segment2i const& tile, TileSamples& samples) const;
+            void restoreTileSamples(Segment2i const& tile, TileSamples const& samples);
+
+            static QRgb tonemap(Color const& radiance);
+
+            QImage image() const;
 
         signals:
-            void imageUpdated(QImage const& image);
+            void imageUpdated(QImage const& image, QRect const& dirtyRect);
 
         private:
             Extent2i m_extent;
-            QImage m_foreground;
-            QImage m_background;
-            bool m_valid;
-            QMutex m_guard;
+            std::vector<Color> m_radianceSums;
+            std::vector<float> m_sqrLuminanceSums;
+            std::vector<float> m_sampleCounts;
+            std::vector<float> m_depths;
+            std::vector<Vector3f> m_normals;
+            int m_pixelStride;
+            QRgb* m_foreground;
+            QRgb* m_background;
+            QRect m_dirtyRect;
+            mutable QMutex m_guard;
             QTimer m_updateEmitter;
+
+            QImage foregroundImage() const;
     };
 }
 
 #include "Surface.inl"
 
-#endif
\ No newline at end of file
+#endif
@@ -1,13 +1,82 @@
 namespace photon_mapping {
+    inline Surface::Row::Row(Color* radianceSums, float* sqrLuminanceSums, float* sampleCounts, float* depths, Vector3f* normals, QRgb* pixels)
+        : m_radianceSums(radianceSums)
+        , m_sqrLuminanceSums(sqrLuminanceSums)
+        , m_sampleCounts(sampleCounts)
+        , m_depths(depths)
+        , m_normals(normals)
+        , m_pixels(pixels)
+    {}
+
+    inline void Surface::Row::setPixel(int x, Color const& color) {
+        setSamples(x, color, sqr(luminance(color)), 1);
+    }
+
+    inline void Surface::Row::setSamples(int x, Color const& radianceSum, float sqrLuminanceSum, int sampleCount) {
+        m_radianceSums[x] = radianceSum;
+        m_sqrLuminanceSums[x] = sqrLuminanceSum;
+        m_sampleCounts[x] = sampleCount;
+        m_pixels[x] = tonemap(radianceSum / sampleCount);
+    }
+
+    inline void Surface::Row::addSamples(int x, Color const& radianceSum, float sqrLuminanceSum, int sampleCount) {
+        m_radianceSums[x] += radianceSum;
+        m_sqrLuminanceSums[x] += sqrLuminanceSum;
+        m_sampleCounts[x] += sampleCount;
+        m_pixels[x] = tonemap(m_radianceSums[x] / m_sampleCounts[x]);
+    }
+
+    inline float Surface::Row::relativeError(int x) const {
+        float sampleCount = m_sampleCounts[x];
+        if (sampleCount < 2.0f) {
+            return inf();
+        }
+        float meanLuminance = luminance(m_radianceSums[x]) / sampleCount;
+        float luminanceVariance = max(0.0f, m_sqrLuminanceSums[x] / sampleCount - sqr(meanLuminance)) * sampleCount / (sampleCount - 1.0f);
+        return sqrt(luminanceVariance / sampleCount) / max(meanLuminance, 0.01f);
+    }
+
+    inline Color Surface::Row::radiance(int x) const {
+        return m_radianceSums[x] / m_sampleCounts[x];
+    }
+
+    inline void Surface::Row::setGeometry(int x, float depth, Vector3f const& normal) {
+        m_depths[x] = depth;
+        m_normals[x] = normal;
+    }
+
+    inline float Surface::Row::depth(int x) const {
+        return m_depths[x];
+    }
+
+    inline Vector3f const& Surface::Row::normal(int x) const {
+        return m_normals[x];
+    }
+
     inline Extent2i Surface::extent() const {
         return m_extent;
     }
 
+    inline Surface::Row Surface::row(int y) {
+        return Row(
+            m_radianceSums.data() + y * m_extent.x,
+            m_sqrLuminanceSums.data() + y * m_extent.x,
+            m_sampleCounts.data() + y * m_extent.x,
+            m_depths.data() + y * m_extent.x,
+            m_normals.data() + y * m_extent.x,
+            m_background + (m_extent.y - 1 - y) * m_pixelStride
+        );
+    }
+
     inline void Surface::setPixel(Point2i const& position, Color const& color) {
-        m_background.setPixel(QPoint(position.x, m_extent.y - 1 - position.y), qRgb(
-            clamp(0, int(color.r * 255), 255),
-            clamp(0, int(color.g * 255), 255),
-            clamp(0, int(color.b * 255), 255)
-        ));
+        row(position.y).setPixel(position.x, color);
+    }
+
+    inline QRgb Surface::tonemap(Color const& radiance) {
+        return qRgb(
+            clamp(0, int(radiance.r * 255), 255),
+            clamp(0, int(radiance.g * 255), 255),
+            clamp(0, int(radiance.b * 255), 255)
+        );
     }
-}
\ No newline at end of file
+}
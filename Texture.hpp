@@ -2,11 +2,14 @@
 #define PHOTON_MAPPING_TEXTURE_HPP
 
 #include <memory>
+#include <vector>
 
 #include <QImage>
+#include <QImageReader>
 
 #include "Color.hpp"
 #include "Point.hpp"
+#include "Extent.hpp"
 
 namespace photon_mapping {
     enum class TextureType {
@@ -23,19 +26,31 @@ namespace photon_mapping {
     template <TextureType type>
     class Texture {
         public:
+            typedef typename internals::TextureFormatDescriptor<type>::Element Element;
+
             static std::shared_ptr<Texture const> const DUMMY;
 
             Texture();
             Texture(QString const& filePath);
-            Texture(typename internals::TextureFormatDescriptor<type>::Element const& value);
+            Texture(QString const& filePath, Extent2i const& maxExtent);
+            Texture(Element const& value);
+
+            Element fetch(Point2f const& texcoord) const;
 
-            typename internals::TextureFormatDescriptor<type>::Element fetch(Point2f const& texcoord) const;
+            bool isUniform() const;
+            Element const& uniformValue() const;
+
+            Extent2i extent() const;
 
             QString filePath() const;
 
         private:
             QString m_filePath;
-            QImage m_image;
+            Extent2i m_extent;
+            std::vector<Element> m_texels;
+
+            void setUniform(Element const& value);
+            void setImage(QImage const& image);
     };
 }
 
@@ -1,5 +1,3 @@
-#include <QColor>
-
 #include "mathFunctions.hpp"
 
 namespace photon_mapping {
@@ -7,76 +5,33 @@ namespace photon_mapping {
         template <>
         struct TextureFormatDescriptor<TextureType::TrueColor> {
             typedef Color Element;
-            static QImage formatImage(QImage const& image) {
-                return image.convertToFormat(QImage::Format_RGB888);
-            }
-            static Color fetch(QImage const& image, Point2i const& point) {
-                QColor c = image.pixel(point.x, point.y);
-                return Color(c.red() / 255.0f, c.green() / 255.0f, c.blue() / 255.0f);
+            static Color texel(QRgb rgb) {
+                return Color(qRed(rgb) / 255.0f, qGreen(rgb) / 255.0f, qBlue(rgb) / 255.0f);
             }
-            static QImage uniformImage(Color const& value) {
-                QImage image(1, 1, QImage::Format_RGB888);
-                image.fill(QColor(
-                    clamp(0, int(value.r * 255), 255),
-                    clamp(0, int(value.g * 255), 255),
-                    clamp(0, int(value.b * 255), 255)    
-                ));
-                return image;
-            }
-            static QImage dummyImage() {
-                return uniformImage(Color::BLACK);
+            static Color dummyValue() {
+                return Color::BLACK;
             }
         };
 
         template <>
         struct TextureFormatDescriptor<TextureType::GrayScale> {
             typedef float Element;
-            static QImage formatImage(QImage const& image) {
-                QImage formattedImage(image.width(), image.height(), QImage::Format_Indexed8);
-                formattedImage.setColorCount(256);
-                for (int x = 0; x < image.width(); ++x) {
-                    for (int y = 0; y < image.height(); ++y) {
-                        formattedImage.setPixel(x, y, qGray(image.pixel(x, y)));
-                    }
-                }
-                return formattedImage;
-            }
-            static float fetch(QImage const& image, Point2i const& point) {
-                int c = image.pixelIndex(point.x, point.y);
-                return c / 255.0f;
+            static float texel(QRgb rgb) {
+                return qGray(rgb) / 255.0f;
             }
-            static QImage uniformImage(float value) {
-                QImage image(1, 1, QImage::Format_Indexed8);
-                image.setColorCount(256);
-                image.setPixel(0, 0, qGray(
-                    clamp(0, int(value * 255), 255),
-                    clamp(0, int(value * 255), 255),
-                    clamp(0, int(value * 255), 255)
-                ));
-                return image;
-            }
-            static QImage dummyImage() {
-                return uniformImage(0.0f);
+            static float dummyValue() {
+                return 0.0f;
             }
         };
 
         template <>
         struct TextureFormatDescriptor<TextureType::NormalMap> {
             typedef Vector3f Element;
-            static QImage formatImage(QImage const& image) {
-                return image.convertToFormat(QImage::Format_RGB888);
-            }
-            static Vector3f fetch(QImage const& image, Point2i const& point) {
-                QColor c = image.pixel(point.x, point.y);
-                return Vector3f((c.red() / 255.0f - 0.5f) * 2.0f, (c.green() / 255.0f - 0.5f) * 2.0f, c.blue() / 255.0f);
+            static Vector3f texel(QRgb rgb) {
+                return Vector3f((qRed(rgb) / 255.0f - 0.5f) * 2.0f, (qGreen(rgb) / 255.0f - 0.5f) * 2.0f, qBlue(rgb) / 255.0f);
             }
-            static QImage uniformImage(Vector3f const& value) {
-                QImage image(1, 1, QImage::Format_RGB888);
-                image.fill(QColor((value.x / 2.0f + 0.5f) * 255, (value.y / 2.0f + 0.5f) * 255, value.z * 255));
-                return image;
-            }
-            static QImage dummyImage() {
-                return uniformImage(Vector3f::UNIT_Z);
+            static Vector3f dummyValue() {
+                return Vector3f::UNIT_Z;
             }
         };
     }
@@ -87,32 +42,94 @@ namespace photon_mapping {
     template <TextureType type>
     Texture<type>::Texture()
         : m_filePath("")
-        , m_image(internals::TextureFormatDescriptor<type>::dummyImage())
-    {}
+    {
+        setUniform(internals::TextureFormatDescriptor<type>::dummyValue());
+    }
 
     template <TextureType type>
     Texture<type>::Texture(QString const& filePath)
         : m_filePath(filePath)
-        , m_image(internals::TextureFormatDescriptor<type>::formatImage(QImage(filePath)))
-    {}
+    {
+        setImage(QImage(filePath));
+    }
 
     template <TextureType type>
-    Texture<type>::Texture(typename internals::TextureFormatDescriptor<type>::Element const& value)
+    Texture<type>::Texture(QString const& filePath, Extent2i const& maxExtent)
+        : m_filePath(filePath)
+    {
+        QImageReader reader(filePath);
+        QSize size = reader.size();
+        if (size.width() > maxExtent.x || size.height() > maxExtent.y) {
+            reader.setScaledSize(size.scaled(maxExtent.x, maxExtent.y, Qt::KeepAspectRatio));
+        }
+        setImage(reader.read());
+    }
+
+    template <TextureType type>
+    Texture<type>::Texture(Element const& value)
         : m_filePath("")
-        , m_image(internals::TextureFormatDescriptor<type>::uniformImage(value))
-    {}
+    {
+        setUniform(value);
+    }
+
+    template <TextureType type>
+    typename Texture<type>::Element Texture<type>::fetch(Point2f const& texcoord) const {
+        if (m_texels.size() == 1) {
+            return m_texels[0];
+        }
+        float x = clamp(0.0f, texcoord.x * (m_extent.x - 1), float(m_extent.x - 1));
+        float y = clamp(0.0f, (1.0f - texcoord.y) * (m_extent.y - 1), float(m_extent.y - 1));
+        int x0 = int(x);
+        int y0 = int(y);
+        int x1 = min(x0 + 1, m_extent.x - 1);
+        int y1 = min(y0 + 1, m_extent.y - 1);
+        float tx = x - x0;
+        float ty = y - y0;
+        Element const* row0 = &m_texels[y0 * m_extent.x];
+        Element const* row1 = &m_texels[y1 * m_extent.x];
+        return (row0[x0] * (1.0f - tx) + row0[x1] * tx) * (1.0f - ty) + (row1[x0] * (1.0f - tx) + row1[x1] * tx) * ty;
+    }
+
+    template <TextureType type>
+    bool Texture<type>::isUniform() const {
+        return m_texels.size() == 1;
+    }
+
+    template <TextureType type>
+    typename Texture<type>::Element const& Texture<type>::uniformValue() const {
+        return m_texels[0];
+    }
 
     template <TextureType type>
-    typename internals::TextureFormatDescriptor<type>::Element Texture<type>::fetch(Point2f const& texcoord) const {
-        Point2i point = Point2i(
-           (texcoord.x * (m_image.width() - 1)),
-           ((1.0f - texcoord.y) * (m_image.height() - 1))
-        );
-        return internals::TextureFormatDescriptor<type>::fetch(m_image, point);
+    Extent2i Texture<type>::extent() const {
+        return m_extent;
     }
 
     template <TextureType type>
     QString Texture<type>::filePath() const {
         return m_filePath;
     }
+
+    template <TextureType type>
+    void Texture<type>::setUniform(Element const& value) {
+        m_extent = Extent2i(1, 1);
+        m_texels.assign(1, value);
+    }
+
+    template <TextureType type>
+    void Texture<type>::setImage(QImage const& image) {
+        QImage rgbImage = image.convertToFormat(QImage::Format_RGB32);
+        if (rgbImage.isNull()) {
+            setUniform(internals::TextureFormatDescriptor<type>::dummyValue());
+            return;
+        }
+        m_extent = Extent2i(rgbImage.width(), rgbImage.height());
+        m_texels.resize(m_extent.x * m_extent.y);
+        for (int y = 0; y < m_extent.y; ++y) {
+            QRgb const* scanLine = reinterpret_cast<QRgb const*>(rgbImage.constScanLine(y));
+            for (int x = 0; x < m_extent.x; ++x) {
+                m_texels[y * m_extent.x + x] = internals::TextureFormatDescriptor<type>::texel(scanLine[x]);
+            }
+        }
+    }
 }
\ No newline at end of file
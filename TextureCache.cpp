@@ -0,0 +1,7 @@
+#include "TextureCache.hpp"
+
+namespace photon_mapping {
+    TextureCache TextureCache::s_instance;
+
+    TextureCache::TextureCache() {}
+}
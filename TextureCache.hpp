@@ -0,0 +1,40 @@
+#ifndef PHOTON_MAPPING_TEXTURE_CACHE_HPP
+#define PHOTON_MAPPING_TEXTURE_CACHE_HPP
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <utility>
+
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+#include "Texture.hpp"
+
+namespace photon_mapping {
+    class TextureCache {
+        public:
+            static TextureCache& instance();
+
+            template <TextureType type>
+            std::vector<std::shared_ptr<Texture<type> const>> textures(QStringList const& filePaths);
+
+            template <TextureType type>
+            std::vector<std::shared_ptr<Texture<type> const>> placeholders(QStringList const& filePaths, Extent2i const& maxExtent);
+
+        private:
+            typedef std::pair<TextureType, QString> Key;
+
+            static TextureCache s_instance;
+
+            QMutex m_guard;
+            std::map<Key, std::weak_ptr<void const>> m_textures;
+
+            TextureCache();
+    };
+}
+
+#include "TextureCache.inl"
+
+#endif
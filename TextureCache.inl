@@ -0,0 +1,76 @@
+#include <QThreadPool>
+
+#include "parallelFor.hpp"
+#include "Trace.hpp"
+
+namespace photon_mapping {
+    inline TextureCache& TextureCache::instance() {
+        return s_instance;
+    }
+
+    template <TextureType type>
+    std::vector<std::shared_ptr<Texture<type> const>> TextureCache::textures(QStringList const& filePaths) {
+        std::vector<std::shared_ptr<Texture<type> const>> textures(filePaths.size());
+        std::map<QString, int> missingIndices;
+        std::vector<int> missing;
+        {
+            QMutexLocker guardLocker(&m_guard);
+            for (int i = 0; i < filePaths.size(); ++i) {
+                auto cached = m_textures.find(Key(type, filePaths[i]));
+                if (cached != m_textures.end()) {
+                    textures[i] = std::static_pointer_cast<Texture<type> const>(cached->second.lock());
+                }
+                if (!textures[i] && missingIndices.insert(std::make_pair(filePaths[i], i)).second) {
+                    missing.push_back(i);
+                }
+            }
+        }
+
+        QThreadPool threadPool;
+        parallelFor(threadPool, missing.size(), [&](int i) {
+            PHOTON_MAPPING_TRACE_SCOPE("decode texture");
+            textures[missing[i]] = std::make_shared<Texture<type>>(filePaths[missing[i]]);
+        });
+
+        {
+            QMutexLocker guardLocker(&m_guard);
+            for (int i : missing) {
+                std::weak_ptr<void const>& cached = m_textures[Key(type, filePaths[i])];
+                if (auto texture = std::static_pointer_cast<Texture<type> const>(cached.lock())) {
+                    textures[i] = texture;
+                } else {
+                    cached = textures[i];
+                }
+            }
+        }
+        for (int i = 0; i < filePaths.size(); ++i) {
+            if (!textures[i]) {
+                textures[i] = textures[missingIndices[filePaths[i]]];
+            }
+        }
+        return textures;
+    }
+
+    template <TextureType type>
+    std::vector<std::shared_ptr<Texture<type> const>> TextureCache::placeholders(QStringList const& filePaths, Extent2i const& maxExtent) {
+        std::vector<std::shared_ptr<Texture<type> const>> placeholders(filePaths.size());
+        {
+            QMutexLocker guardLocker(&m_guard);
+            for (int i = 0; i < filePaths.size(); ++i) {
+                auto cached = m_textures.find(Key(type, filePaths[i]));
+                if (cached != m_textures.end()) {
+                    placeholders[i] = std::static_pointer_cast<Texture<type> const>(cached->second.lock());
+                }
+            }
+        }
+
+        QThreadPool threadPool;
+        parallelFor(threadPool, placeholders.size(), [&](int i) {
+            if (!placeholders[i]) {
+                PHOTON_MAPPING_TRACE_SCOPE("decode texture placeholder");
+                placeholders[i] = std::make_shared<Texture<type>>(filePaths[i], maxExtent);
+            }
+        });
+        return placeholders;
+    }
+}
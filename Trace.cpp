@@ -0,0 +1,90 @@
+#include "Trace.hpp"
+
+#ifdef PHOTON_MAPPING_TRACING
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QFile>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace photon_mapping {
+    Trace Trace::s_instance;
+
+    Trace::Trace()
+        : m_oldestEvent(0)
+    {
+        m_clock.start();
+    }
+
+    void Trace::setThreadName(QString const& name) {
+        QMutexLocker guardLocker(&m_guard);
+        m_threadNames[(quintptr)QThread::currentThreadId()] = name;
+    }
+
+    void Trace::addEvent(QString const& name, qint64 beginNsecs, qint64 endNsecs) {
+        Event event;
+        event.name = name;
+        event.threadId = (quintptr)QThread::currentThreadId();
+        event.beginNsecs = beginNsecs;
+        event.endNsecs = endNsecs;
+        QMutexLocker guardLocker(&m_guard);
+        if (int(m_events.size()) < MAX_EVENT_COUNT) {
+            m_events.push_back(event);
+        } else {
+            m_events[m_oldestEvent] = event;
+            m_oldestEvent = (m_oldestEvent + 1) % MAX_EVENT_COUNT;
+        }
+    }
+
+    void Trace::clear() {
+        QMutexLocker guardLocker(&m_guard);
+        m_events.clear();
+        m_oldestEvent = 0;
+    }
+
+    bool Trace::save(QString const& filePath) const {
+        QMutexLocker guardLocker(&m_guard);
+        std::map<quintptr, int> threadIndices;
+        auto threadIndex = [&](quintptr threadId) -> int {
+            auto i = threadIndices.find(threadId);
+            if (i == threadIndices.end()) {
+                i = threadIndices.insert(std::make_pair(threadId, (int)threadIndices.size() + 1)).first;
+            }
+            return i->second;
+        };
+        QJsonArray traceEvents;
+        for (std::size_t i = 0; i < m_events.size(); ++i) {
+            Event const& event = m_events[(m_oldestEvent + i) % m_events.size()];
+            QJsonObject traceEvent;
+            traceEvent["name"] = event.name;
+            traceEvent["ph"] = QString("X");
+            traceEvent["pid"] = 1;
+            traceEvent["tid"] = threadIndex(event.threadId);
+            traceEvent["ts"] = event.beginNsecs / 1e3;
+            traceEvent["dur"] = (event.endNsecs - event.beginNsecs) / 1e3;
+            traceEvents.append(traceEvent);
+        }
+        for (auto const& threadName : m_threadNames) {
+            QJsonObject args;
+            args["name"] = threadName.second;
+            QJsonObject traceEvent;
+            traceEvent["name"] = QString("thread_name");
+            traceEvent["ph"] = QString("M");
+            traceEvent["pid"] = 1;
+            traceEvent["tid"] = threadIndex(threadName.first);
+            traceEvent["args"] = args;
+            traceEvents.append(traceEvent);
+        }
+        QJsonObject trace;
+        trace["traceEvents"] = traceEvents;
+        trace["displayTimeUnit"] = QString("ms");
+        QByteArray traceJson = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+
+        QFile traceFile(filePath);
+        return traceFile.open(QIODevice::WriteOnly) && traceFile.write(traceJson) == traceJson.size();
+    }
+}
+
+#endif
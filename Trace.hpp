@@ -0,0 +1,70 @@
+#ifndef PHOTON_MAPPING_TRACE_HPP
+#define PHOTON_MAPPING_TRACE_HPP
+
+#ifdef PHOTON_MAPPING_TRACING
+
+#include <vector>
+#include <map>
+
+#include <QString>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#define PHOTON_MAPPING_TRACE_CONCATENATE_IMPL(a, b) a##b
+#define PHOTON_MAPPING_TRACE_CONCATENATE(a, b) PHOTON_MAPPING_TRACE_CONCATENATE_IMPL(a, b)
+#define PHOTON_MAPPING_TRACE_SCOPE(name) photon_mapping::TraceScope PHOTON_MAPPING_TRACE_CONCATENATE(traceScope, __LINE__)(name)
+#define PHOTON_MAPPING_TRACE_THREAD_NAME(name) photon_mapping::Trace::instance().setThreadName(name)
+
+namespace photon_mapping {
+    class Trace {
+        public:
+            static Trace& instance();
+
+            qint64 nsecsElapsed() const;
+            void setThreadName(QString const& name);
+            void addEvent(QString const& name, qint64 beginNsecs, qint64 endNsecs);
+            void clear();
+            bool save(QString const& filePath) const;
+
+        private:
+            struct Event {
+                QString name;
+                quintptr threadId;
+                qint64 beginNsecs;
+                qint64 endNsecs;
+            };
+
+            static int const MAX_EVENT_COUNT = 1 << 20;
+
+            static Trace s_instance;
+
+            QElapsedTimer m_clock;
+            mutable QMutex m_guard;
+            std::vector<Event> m_events;
+            int m_oldestEvent;
+            std::map<quintptr, QString> m_threadNames;
+
+            Trace();
+    };
+
+    class TraceScope {
+        public:
+            TraceScope(QString const& name);
+            ~TraceScope();
+
+        private:
+            QString m_name;
+            qint64 m_beginNsecs;
+    };
+}
+
+#include "Trace.inl"
+
+#else
+
+#define PHOTON_MAPPING_TRACE_SCOPE(name)
+#define PHOTON_MAPPING_TRACE_THREAD_NAME(name)
+
+#endif
+
+#endif
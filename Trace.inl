@@ -0,0 +1,18 @@
+namespace photon_mapping {
+    inline Trace& Trace::instance() {
+        return s_instance;
+    }
+
+    inline qint64 Trace::nsecsElapsed() const {
+        return m_clock.nsecsElapsed();
+    }
+
+    inline TraceScope::TraceScope(QString const& name)
+        : m_name(name)
+        , m_beginNsecs(Trace::instance().nsecsElapsed())
+    {}
+
+    inline TraceScope::~TraceScope() {
+        Trace::instance().addEvent(m_name, m_beginNsecs, Trace::instance().nsecsElapsed());
+    }
+}
@@ -2,6 +2,8 @@
 
 #include <QMutexLocker>
 
+#include "Trace.hpp"
+
 namespace photon_mapping {
     Worker::Worker(WorkerSet* set, int index)
         : m_set(set)
@@ -17,9 +19,13 @@ namespace photon_mapping {
         , m_workers(m_workerCount)
         , m_workerDoneCount(0)
         , m_workerAbortedCount(0)
+        , m_busy(false)
+        , m_workerArrivalNsecs(m_workerCount)
+        , m_workerBarrierWaitNsecs(m_workerCount)
         , m_abortRequested(false)
         , m_exitRequested(false)
     {
+        m_clock.start();
         for (int workerIndex = 0; workerIndex < m_workerCount; ++workerIndex) {
             m_workers[workerIndex] = new Worker(this, workerIndex);
         }
@@ -43,6 +49,11 @@ namespace photon_mapping {
     }
 
     void WorkerSet::start() {
+        QMutexLocker syncronizerLocker(&m_syncronizer);
+        if (!nextTask()) {
+            return;
+        }
+        m_busy = true;
         m_taskStarted.wakeAll();
     }
 
@@ -55,6 +66,13 @@ namespace photon_mapping {
         }
     }
 
+    void WorkerSet::wait() {
+        QMutexLocker syncronizerLocker(&m_syncronizer);
+        while (m_busy) {
+            m_allIdle.wait(&m_syncronizer);
+        }
+    }
+
     void WorkerSet::taskDone() {
         // do nothing
     }
@@ -64,10 +82,12 @@ namespace photon_mapping {
     }
 
     void WorkerSet::workerLoop(int workerIndex) {
+        PHOTON_MAPPING_TRACE_THREAD_NAME(QString("worker %1").arg(workerIndex));
         try {
             while (true) {
                 bool taskPartAborted;
                 try {
+                    PHOTON_MAPPING_TRACE_SCOPE("task part");
                     checkInterrupts();
                     doTaskPart(workerIndex);
                     taskPartAborted = false;
@@ -75,7 +95,9 @@ namespace photon_mapping {
                     taskPartAborted = true;
                 }
 
+                PHOTON_MAPPING_TRACE_SCOPE("barrier");
                 QMutexLocker syncronizerLocker(&m_syncronizer);
+                m_workerArrivalNsecs[workerIndex] = m_clock.nsecsElapsed();
                 if (taskPartAborted) {
                     ++m_workerAbortedCount;
                 } else {
@@ -84,8 +106,13 @@ namespace photon_mapping {
                 if (m_workerDoneCount + m_workerAbortedCount < m_workerCount) {
                     m_taskStarted.wait(&m_syncronizer);
                 } else {
+                    for (int otherWorkerIndex = 0; otherWorkerIndex < m_workerCount; ++otherWorkerIndex) {
+                        m_workerBarrierWaitNsecs[otherWorkerIndex] = m_workerArrivalNsecs[workerIndex] - m_workerArrivalNsecs[otherWorkerIndex];
+                    }
                     if (m_workerAbortedCount > 0) {
                         taskAborted();
+                        m_busy = false;
+                        m_allIdle.wakeAll();
                         m_allAborted.wakeOne();
                         m_taskStarted.wait(&m_syncronizer);
                     } else {
@@ -93,6 +120,8 @@ namespace photon_mapping {
                         if (nextTask()) {
                             m_taskStarted.wakeAll();
                         } else {
+                            m_busy = false;
+                            m_allIdle.wakeAll();
                             m_taskStarted.wait(&m_syncronizer);
                         }
                     }
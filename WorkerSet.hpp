@@ -7,6 +7,7 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QAtomicInt>
+#include <QElapsedTimer>
 
 namespace photon_mapping {
     class WorkerSet;
@@ -37,9 +38,11 @@ namespace photon_mapping {
         
             void start();
             void abort();
+            void wait();
 
         protected:
             int workerCount() const;
+            qint64 barrierWaitNsecs(int workerIndex) const;
             void checkInterrupts() const;
             virtual bool nextTask() = 0;
             virtual void doTaskPart(int workerIndex) = 0;
@@ -56,8 +59,13 @@ namespace photon_mapping {
             QMutex m_syncronizer;
             QWaitCondition m_taskStarted;
             QWaitCondition m_allAborted;
+            QWaitCondition m_allIdle;
             int m_workerDoneCount;
             int m_workerAbortedCount;
+            bool m_busy;
+            QElapsedTimer m_clock;
+            std::vector<qint64> m_workerArrivalNsecs;
+            std::vector<qint64> m_workerBarrierWaitNsecs;
             QAtomicInt m_abortRequested;
             QAtomicInt m_exitRequested;
 
@@ -3,6 +3,10 @@ namespace photon_mapping {
         return m_workerCount;
     }
 
+    inline qint64 WorkerSet::barrierWaitNsecs(int workerIndex) const {
+        return m_workerBarrierWaitNsecs[workerIndex];
+    }
+
     inline void WorkerSet::checkInterrupts() const {
         if (m_abortRequested.load()) {
             throw AbortInterrupt();
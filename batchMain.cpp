@@ -0,0 +1,6 @@
+#include "BatchApplication.hpp"
+
+int main(int argc, char *argv[]) {
+    using namespace photon_mapping;
+    return BatchApplication(argc, argv).run();
+}
@@ -0,0 +1,6 @@
+#include "BenchmarkApplication.hpp"
+
+int main(int argc, char *argv[]) {
+    using namespace photon_mapping;
+    return BenchmarkApplication(argc, argv).run();
+}
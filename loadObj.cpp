@@ -1,21 +1,480 @@
 #include "loadObj.hpp"
 
-#include <QRegularExpression>
-#include <QTextStream>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
 #include <QStringList>
+#include <QByteArray>
 #include <QDir>
 #include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
 
 #include "Material.hpp"
+#include "TextureCache.hpp"
+#include "parallelFor.hpp"
+#include "sceneCache.hpp"
+#include "Trace.hpp"
 
 namespace photon_mapping {
-    static void loadMtl(std::map<QString, std::shared_ptr<Material>>& materials, QTextStream& textStream, QString const& dirPath) {
+    namespace {
+        struct TriangleCorners {
+            int texcoords[3];
+            int spaces[3];
+        };
+
+        struct VertexHash {
+            std::size_t operator()(Mesh::Vertex const& vertex) const {
+                unsigned char const* bytes = reinterpret_cast<unsigned char const*>(&vertex);
+                std::size_t hash = 2166136261u;
+                for (std::size_t i = 0; i < sizeof(vertex); ++i) {
+                    hash = (hash ^ bytes[i]) * 16777619u;
+                }
+                return hash;
+            }
+        };
+
+        struct VertexEqual {
+            bool operator()(Mesh::Vertex const& a, Mesh::Vertex const& b) const {
+                return std::memcmp(&a, &b, sizeof(a)) == 0;
+            }
+        };
+
+        struct ObjectBuilder {
+            std::vector<Mesh::Triangle> triangles;
+            std::vector<Mesh::TriangleAttributes> triangleAttributes;
+            std::vector<TriangleCorners> triangleCorners;
+            std::vector<Mesh::Vertex> vertices;
+        };
+
+        struct PendingMesh {
+            QString name;
+            ObjectBuilder objectBuilder;
+            qint64 objectBuilderBytes;
+            std::shared_ptr<Mesh const> mesh;
+            QAtomicInt built;
+        };
+
+        class MeshBuild
+            : public QRunnable
+        {
+            public:
+                MeshBuild(PendingMesh* pendingMesh)
+                    : m_pendingMesh(pendingMesh)
+                {}
+
+                virtual void run() {
+                    PHOTON_MAPPING_TRACE_SCOPE("build OBJ mesh");
+                    ObjectBuilder& objectBuilder = m_pendingMesh->objectBuilder;
+                    m_pendingMesh->mesh = std::make_shared<Mesh const>(objectBuilder.triangles, objectBuilder.triangleAttributes, objectBuilder.vertices);
+                    objectBuilder = ObjectBuilder();
+                    m_pendingMesh->built.storeRelease(1);
+                }
+
+            private:
+                PendingMesh* m_pendingMesh;
+        };
+
+        struct VertexRange {
+            int trianglesBegin;
+            int trianglesEnd;
+            int verticesBegin;
+            std::vector<Mesh::Vertex> vertices;
+            qint64 vertexIndicesBytes;
+        };
+
+        struct ChunkFace {
+            int vertices[3];
+            int texcoords[3];
+            int spaces[3];
+            int relativeMask;
+        };
+
+        struct ChunkStatement {
+            int faceIndex;
+            QStringList tokens;
+        };
+
+        struct Chunk {
+            char const* begin;
+            char const* end;
+            std::vector<Point3f> vertices;
+            std::vector<Vector3f> normals;
+            std::vector<Point2f> texcoords;
+            std::vector<ChunkFace> faces;
+            std::vector<ChunkStatement> statements;
+        };
+
+        bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        bool isTokenEnd(char const* position, char const* end) {
+            return position == end || isSpace(*position) || *position == '\n' || *position == '#';
+        }
+
+        bool isLineEnd(char const* position, char const* end) {
+            return position == end || *position == '\n' || *position == '#';
+        }
+
+        void skipSpaces(char const*& position, char const* end) {
+            while (position != end && isSpace(*position)) {
+                ++position;
+            }
+        }
+
+        void skipToken(char const*& position, char const* end) {
+            while (!isTokenEnd(position, end)) {
+                ++position;
+            }
+        }
+
+        void skipLine(char const*& position, char const* end) {
+            while (position != end && *position != '\n') {
+                ++position;
+            }
+            if (position != end) {
+                ++position;
+            }
+        }
+
+        bool parseKeyword(char const*& position, char const* end, char const* keyword) {
+            std::size_t length = std::strlen(keyword);
+            if (std::size_t(end - position) < length || std::memcmp(position, keyword, length) != 0 || !isTokenEnd(position + length, end)) {
+                return false;
+            }
+            position += length;
+            return true;
+        }
+
+        int parseInt(char const*& position, char const* end) {
+            bool negative = false;
+            if (position != end && (*position == '-' || *position == '+')) {
+                negative = (*position == '-');
+                ++position;
+            }
+            int value = 0;
+            while (position != end && '0' <= *position && *position <= '9') {
+                value = value * 10 + (*position - '0');
+                ++position;
+            }
+            return negative ? -value : value;
+        }
+
+        float parseFloat(char const*& position, char const* end) {
+            static double const POWERS_OF_TEN[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            skipSpaces(position, end);
+            bool negative = false;
+            if (position != end && (*position == '-' || *position == '+')) {
+                negative = (*position == '-');
+                ++position;
+            }
+            double mantissa = 0.0;
+            int exponent = 0;
+            while (position != end && '0' <= *position && *position <= '9') {
+                mantissa = mantissa * 10.0 + (*position - '0');
+                ++position;
+            }
+            if (position != end && *position == '.') {
+                ++position;
+                while (position != end && '0' <= *position && *position <= '9') {
+                    mantissa = mantissa * 10.0 + (*position - '0');
+                    --exponent;
+                    ++position;
+                }
+            }
+            if (position != end && (*position == 'e' || *position == 'E')) {
+                ++position;
+                exponent += parseInt(position, end);
+            }
+            skipToken(position, end);
+            double value;
+            if (-22 <= exponent && exponent < 0) {
+                value = mantissa / POWERS_OF_TEN[-exponent];
+            } else if (0 <= exponent && exponent <= 22) {
+                value = mantissa * POWERS_OF_TEN[exponent];
+            } else {
+                value = mantissa * std::pow(10.0, exponent);
+            }
+            return float(negative ? -value : value);
+        }
+
+        float wrapTexcoord(float x) {
+            while (x < 0.0f) {
+                x += 1.0f;
+            }
+            while (x > 1.0f) {
+                x -= 1.0f;
+            }
+            return x;
+        }
+
+        QStringList parseTokens(char const*& position, char const* end) {
+            QStringList tokens;
+            while (true) {
+                skipSpaces(position, end);
+                if (isLineEnd(position, end)) {
+                    break;
+                }
+                char const* tokenBegin = position;
+                skipToken(position, end);
+                tokens.append(QString::fromUtf8(tokenBegin, position - tokenBegin));
+            }
+            return tokens;
+        }
+
+        void parseChunk(Chunk& chunk) {
+            PHOTON_MAPPING_TRACE_SCOPE("parse OBJ chunk");
+            char const* position = chunk.begin;
+            char const* end = chunk.end;
+            while (position != end) {
+                skipSpaces(position, end);
+                char const* statementBegin = position;
+                if (parseKeyword(position, end, "v")) {
+                    float x = parseFloat(position, end);
+                    float y = parseFloat(position, end);
+                    float z = parseFloat(position, end);
+                    chunk.vertices.push_back(Point3f(x, y, z));
+                } else if (parseKeyword(position, end, "vn")) {
+                    float x = parseFloat(position, end);
+                    float y = parseFloat(position, end);
+                    float z = parseFloat(position, end);
+                    chunk.normals.push_back(Vector3f(x, y, z));
+                } else if (parseKeyword(position, end, "vt")) {
+                    float x = wrapTexcoord(parseFloat(position, end));
+                    float y = wrapTexcoord(parseFloat(position, end));
+                    chunk.texcoords.push_back(Point2f(x, y));
+                } else if (parseKeyword(position, end, "f")) {
+                    int vertices[4];
+                    int texcoords[4];
+                    int spaces[4];
+                    int referenceCount = 0;
+                    while (true) {
+                        skipSpaces(position, end);
+                        if (isLineEnd(position, end)) {
+                            break;
+                        }
+                        if (referenceCount < 4) {
+                            vertices[referenceCount] = parseInt(position, end);
+                            texcoords[referenceCount] = 0;
+                            spaces[referenceCount] = 0;
+                            if (position != end && *position == '/') {
+                                ++position;
+                                if (position != end && *position != '/') {
+                                    texcoords[referenceCount] = parseInt(position, end);
+                                }
+                                if (position != end && *position == '/') {
+                                    ++position;
+                                    spaces[referenceCount] = parseInt(position, end);
+                                }
+                            }
+                        }
+                        skipToken(position, end);
+                        ++referenceCount;
+                    }
+                    static int const QUAD_CORNERS[2][3] = {{2, 3, 0}, {0, 1, 2}};
+                    if (referenceCount == 3 || referenceCount == 4) {
+                        for (int corners = (referenceCount == 4) ? 0 : 1; corners < 2; ++corners) {
+                            ChunkFace face;
+                            face.relativeMask = 0;
+                            for (int i = 0; i < 3; ++i) {
+                                int j = QUAD_CORNERS[corners][i];
+                                face.vertices[i] = vertices[j];
+                                if (face.vertices[i] < 0) {
+                                    face.vertices[i] += chunk.vertices.size() + 1;
+                                    face.relativeMask |= 1 << (3 * i + 0);
+                                }
+                                face.texcoords[i] = texcoords[j];
+                                if (face.texcoords[i] < 0) {
+                                    face.texcoords[i] += chunk.texcoords.size() + 1;
+                                    face.relativeMask |= 1 << (3 * i + 1);
+                                }
+                                face.spaces[i] = spaces[j];
+                                if (face.spaces[i] < 0) {
+                                    face.spaces[i] += chunk.normals.size() + 1;
+                                    face.relativeMask |= 1 << (3 * i + 2);
+                                }
+                            }
+                            chunk.faces.push_back(face);
+                        }
+                    }
+                } else if (parseKeyword(position, end, "usemtl") || parseKeyword(position, end, "mtllib") || parseKeyword(position, end, "o")) {
+                    position = statementBegin;
+                    ChunkStatement statement;
+                    statement.faceIndex = chunk.faces.size();
+                    statement.tokens = parseTokens(position, end);
+                    chunk.statements.push_back(statement);
+                }
+                skipLine(position, end);
+            }
+        }
+
+        Point2f cornerTexcoord(std::vector<Point2f> const& texcoords, int texcoord) {
+            return (texcoord != 0) ? texcoords[texcoord - 1] : Point2f::ORIGIN;
+        }
+
+        int cornerOwners(TriangleCorners const& triangleCorners, int spacesBegin, int spaceCount, int ownerCount, int owners[3]) {
+            int distinctOwnerCount = 0;
+            for (int j = 0; j < 3; ++j) {
+                int space = triangleCorners.spaces[j];
+                if (space < spacesBegin || space >= spacesBegin + spaceCount) {
+                    continue;
+                }
+                int owner = int(qint64(space - spacesBegin) * ownerCount / spaceCount);
+                if (std::find(owners, owners + distinctOwnerCount, owner) == owners + distinctOwnerCount) {
+                    owners[distinctOwnerCount++] = owner;
+                }
+            }
+            return distinctOwnerCount;
+        }
+
+        void accumulateTangents(QThreadPool& threadPool, int taskCount, ObjectBuilder const& objectBuilder, std::vector<Point2f> const& texcoords, int spacesBegin, int spacesEnd, std::vector<Vector3f>& tangents, std::vector<Vector3f>& bitangents) {
+            int triangleCount = objectBuilder.triangles.size();
+            int spaceCount = spacesEnd - spacesBegin;
+            taskCount = min(taskCount, min(triangleCount, spaceCount));
+            if (taskCount == 0) {
+                return;
+            }
+            std::vector<int> bucketOffsets(taskCount * taskCount + 1, 0);
+            parallelFor(threadPool, taskCount, [&](int range) {
+                int trianglesBegin = qint64(triangleCount) * range / taskCount;
+                int trianglesEnd = qint64(triangleCount) * (range + 1) / taskCount;
+                int owners[3];
+                for (int i = trianglesBegin; i < trianglesEnd; ++i) {
+                    int ownerCount = cornerOwners(objectBuilder.triangleCorners[i], spacesBegin, spaceCount, taskCount, owners);
+                    for (int k = 0; k < ownerCount; ++k) {
+                        ++bucketOffsets[1 + owners[k] * taskCount + range];
+                    }
+                }
+            });
+            std::partial_sum(bucketOffsets.begin(), bucketOffsets.end(), bucketOffsets.begin());
+            std::vector<int> buckets(bucketOffsets.back());
+            parallelFor(threadPool, taskCount, [&](int range) {
+                int trianglesBegin = qint64(triangleCount) * range / taskCount;
+                int trianglesEnd = qint64(triangleCount) * (range + 1) / taskCount;
+                std::vector<int> cursors(taskCount);
+                for (int owner = 0; owner < taskCount; ++owner) {
+                    cursors[owner] = bucketOffsets[owner * taskCount + range];
+                }
+                int owners[3];
+                for (int i = trianglesBegin; i < trianglesEnd; ++i) {
+                    int ownerCount = cornerOwners(objectBuilder.triangleCorners[i], spacesBegin, spaceCount, taskCount, owners);
+                    for (int k = 0; k < ownerCount; ++k) {
+                        buckets[cursors[owners[k]]++] = i;
+                    }
+                }
+            });
+            parallelFor(threadPool, taskCount, [&](int owner) {
+                for (int bucket = bucketOffsets[owner * taskCount]; bucket < bucketOffsets[(owner + 1) * taskCount]; ++bucket) {
+                    int i = buckets[bucket];
+                    Mesh::Triangle const& triangle = objectBuilder.triangles[i];
+                    TriangleCorners const& triangleCorners = objectBuilder.triangleCorners[i];
+                    Vector2f texcoordEdge01 = cornerTexcoord(texcoords, triangleCorners.texcoords[1]) - cornerTexcoord(texcoords, triangleCorners.texcoords[0]);
+                    Vector2f texcoordEdge02 = cornerTexcoord(texcoords, triangleCorners.texcoords[2]) - cornerTexcoord(texcoords, triangleCorners.texcoords[0]);
+                    float d = texcoordEdge01.x * texcoordEdge02.y - texcoordEdge01.y * texcoordEdge02.x;
+                    if (d == 0.0f) {
+                        continue;
+                    }
+                    float id = 1.0f / d;
+                    Vector3f tangent = (triangle.edge01 * (+texcoordEdge02.y) + triangle.edge02 * (-texcoordEdge01.y)) * id;
+                    Vector3f bitangent = (triangle.edge01 * (-texcoordEdge02.x) + triangle.edge02 * (+texcoordEdge01.x)) * id;
+                    for (int j = 0; j < 3; ++j) {
+                        int space = triangleCorners.spaces[j];
+                        if (spacesBegin <= space && space < spacesEnd && int(qint64(space - spacesBegin) * taskCount / spaceCount) == owner) {
+                            tangents[space - spacesBegin] += tangent;
+                            bitangents[space - spacesBegin] += bitangent;
+                        }
+                    }
+                }
+            });
+        }
+
+        template <typename T>
+        qint64 byteSize(std::vector<T> const& elements) {
+            return qint64(elements.capacity()) * sizeof(T);
+        }
+
+        template <typename T>
+        qint64 byteSize(Array<T> const& elements) {
+            return qint64(elements.size()) * sizeof(T);
+        }
+
+        qint64 byteSize(Mesh const& mesh) {
+            return byteSize(mesh.triangles()) + byteSize(mesh.triangleAttributes()) + byteSize(mesh.vertices()) + byteSize(mesh.inclusiveCumulativeTriangleProbabilities())
+                + byteSize(mesh.boundingIntervalHierarchy().nodes()) + byteSize(mesh.boundingIntervalHierarchy().primitiveIndices());
+        }
+
+        template <typename T>
+        void release(std::vector<T>& elements) {
+            std::vector<T>().swap(elements);
+        }
+
+        enum class MaterialMap {
+            Emission,
+            Diffuse,
+            Specular,
+            Normal,
+        };
+
+        struct TextureReference {
+            std::shared_ptr<Material> material;
+            QString filePath;
+        };
+
+        typedef std::map<std::pair<Material const*, MaterialMap>, TextureReference> TextureReferences;
+
+        void setUniformMap(TextureReferences& textureReferences, std::shared_ptr<Material> const& material, MaterialMap map) {
+            textureReferences.erase(std::make_pair(material.get(), map));
+        }
+
+        void setTextureMap(TextureReferences& textureReferences, std::shared_ptr<Material> const& material, MaterialMap map, QString const& filePath) {
+            TextureReference& textureReference = textureReferences[std::make_pair(material.get(), map)];
+            textureReference.material = material;
+            textureReference.filePath = filePath;
+        }
+
+        std::shared_ptr<Object> makeObject(QString const& name, std::shared_ptr<Mesh const> const& mesh, std::map<QString, std::shared_ptr<Material>> const& materials) {
+            auto object = std::make_shared<Object>();
+            object->setName(name);
+            object->setMesh(mesh);
+            for (auto material = materials.begin(); material != materials.end(); ++material) {
+                object->setMaterial(std::distance(materials.begin(), material), material->second);
+            }
+            return object;
+        }
+
+        bool isAborted(LoadObjListener const* listener) {
+            return listener && listener->isAborted();
+        }
+
+        QByteArray readFile(QString const& filePath) {
+            QFile file(filePath);
+            if (!file.open(QFile::ReadOnly)) {
+                return QByteArray();
+            }
+            return file.readAll();
+        }
+    }
+
+    static void loadMtl(std::map<QString, std::shared_ptr<Material>>& materials, TextureReferences& textureReferences, char const* begin, char const* end, QString const& dirPath) {
         std::shared_ptr<Material> material;
-        while (!textStream.atEnd()) {
-            QString line = textStream.readLine();
-            line.remove(QRegularExpression("#.*"));
-            line.replace('\t', ' ');
-            QStringList l = line.split(' ', QString::SkipEmptyParts);
+        char const* position = begin;
+        while (position != end) {
+            QStringList l = parseTokens(position, end);
+            skipLine(position, end);
 
             if (l.isEmpty()) {
                 continue;
@@ -33,12 +492,13 @@ namespace photon_mapping {
                 float g = l[2].toFloat();
                 float b = l[3].toFloat();
                 material->setEmission(std::make_shared<Texture<TextureType::TrueColor>>(Color(r, g, b)));
+                setUniformMap(textureReferences, material, MaterialMap::Emission);
                 continue;
             }
 
             if (l[0] == "map_Ke") {
                 QString mapFilePath = QDir::cleanPath(QDir(dirPath).filePath(l.last()));
-                material->setEmission(std::make_shared<Texture<TextureType::TrueColor>>(mapFilePath));
+                setTextureMap(textureReferences, material, MaterialMap::Emission, mapFilePath);
                 continue;
             }
 
@@ -53,12 +513,13 @@ namespace photon_mapping {
                 float g = l[2].toFloat();
                 float b = l[3].toFloat();
                 material->setDiffuse(std::make_shared<Texture<TextureType::TrueColor>>(Color(r, g, b)));
+                setUniformMap(textureReferences, material, MaterialMap::Diffuse);
                 continue;
             }
 
             if (l[0] == "map_Kd") {
                 QString mapFilePath = QDir::cleanPath(QDir(dirPath).filePath(l.last()));
-                material->setDiffuse(std::make_shared<Texture<TextureType::TrueColor>>(mapFilePath));
+                setTextureMap(textureReferences, material, MaterialMap::Diffuse, mapFilePath);
                 continue;
             }
 
@@ -67,12 +528,13 @@ namespace photon_mapping {
                 float g = l[2].toFloat();
                 float b = l[3].toFloat();
                 material->setSpecular(std::make_shared<Texture<TextureType::TrueColor>>(Color(r, g, b)));
+                setUniformMap(textureReferences, material, MaterialMap::Specular);
                 continue;
             }
 
             if (l[0] == "map_Ks") {
                 QString mapFilePath = QDir::cleanPath(QDir(dirPath).filePath(l.last()));
-                material->setSpecular(std::make_shared<Texture<TextureType::TrueColor>>(mapFilePath));
+                setTextureMap(textureReferences, material, MaterialMap::Specular, mapFilePath);
                 continue;
             }
 
@@ -98,237 +560,431 @@ namespace photon_mapping {
 
             if (l[0] == "bump") {
                 QString mapFilePath = QDir::cleanPath(QDir(dirPath).filePath(l.last()));
-                material->setNormal(std::make_shared<Texture<TextureType::NormalMap>>(mapFilePath));
+                setTextureMap(textureReferences, material, MaterialMap::Normal, mapFilePath);
                 continue;
             }
         }
     }
     
-    static void loadMtl(std::map<QString, std::shared_ptr<Material>>& materials, QString const& mtlFilePath) {
-        QFile file(mtlFilePath);
-        if (file.open(QFile::ReadOnly | QFile::Text)) {
-            QTextStream textStream(&file);
-            loadMtl(materials, textStream, QDir(mtlFilePath).filePath("../"));
-        }
+    
+    static void loadMtl(std::map<QString, std::shared_ptr<Material>>& materials, TextureReferences& textureReferences, QString const& mtlFilePath) {
+        QByteArray contents = readFile(mtlFilePath);
+        loadMtl(materials, textureReferences, contents.constData(), contents.constData() + contents.size(), QDir(mtlFilePath).filePath("../"));
     }
 
-    static void loadObj(std::shared_ptr<Scene> const& scene, QTextStream& textStream, QString const& dirPath) {
-        std::vector<Point3f> vertices;
-        std::vector<Vector3f> tangents;
-        std::vector<Vector3f> bitangents;
-        std::vector<Vector3f> normals;
-        std::vector<Point2f> texcoords;
-        std::map<QString, std::shared_ptr<Material>> materials;
-        int currentMaterialIndex = -1;
-        struct Face {
-            int vertices[3];
-            int texcoords[3];
-            int spaces[3];
-            int materialIndex;
-        };
-        std::map<QString, std::vector<Face>> objects;
-        std::vector<Face>* currentObjectFaces = nullptr;
-        
-        while (!textStream.atEnd()) {
-            QString line = textStream.readLine();
-            line.remove(QRegularExpression("#.*"));
-            line.replace('\t', ' ');
-            QStringList l = line.split(' ', QString::SkipEmptyParts);
-
-            if (l.isEmpty()) {
-                continue;
+    static void textureFilePaths(TextureReferences const& textureReferences, QStringList& colorFilePaths, QStringList& normalFilePaths) {
+        for (auto const& textureReference : textureReferences) {
+            if (textureReference.first.second == MaterialMap::Normal) {
+                normalFilePaths.append(textureReference.second.filePath);
+            } else {
+                colorFilePaths.append(textureReference.second.filePath);
             }
+        }
+        colorFilePaths.removeDuplicates();
+        normalFilePaths.removeDuplicates();
+    }
 
-            if (l[0] == "v") {
-                float x = l[1].toFloat();
-                float y = l[2].toFloat();
-                float z = l[3].toFloat();
-                vertices.push_back(Point3f(x, y, z));
-                continue;
+    static void assignTextures(TextureReferences const& textureReferences,
+        QStringList const& colorFilePaths, std::vector<std::shared_ptr<Texture<TextureType::TrueColor> const>> const& colorTextures,
+        QStringList const& normalFilePaths, std::vector<std::shared_ptr<Texture<TextureType::NormalMap> const>> const& normalTextures)
+    {
+        for (auto const& textureReference : textureReferences) {
+            Material& material = *textureReference.second.material;
+            QString const& filePath = textureReference.second.filePath;
+            switch (textureReference.first.second) {
+                case MaterialMap::Emission:
+                    material.setEmission(colorTextures[colorFilePaths.indexOf(filePath)]);
+                    break;
+                case MaterialMap::Diffuse:
+                    material.setDiffuse(colorTextures[colorFilePaths.indexOf(filePath)]);
+                    break;
+                case MaterialMap::Specular:
+                    material.setSpecular(colorTextures[colorFilePaths.indexOf(filePath)]);
+                    break;
+                case MaterialMap::Normal:
+                    material.setNormal(normalTextures[normalFilePaths.indexOf(filePath)]);
+                    break;
             }
+        }
+    }
 
-            if (l[0] == "vn") {
-                float x = l[1].toFloat();
-                float y = l[2].toFloat();
-                float z = l[3].toFloat();
-                normals.push_back(Vector3f(x, y, z));
-                continue;
-            }
+    static void loadTextures(TextureReferences const& textureReferences) {
+        PHOTON_MAPPING_TRACE_SCOPE("load textures");
+        QStringList colorFilePaths;
+        QStringList normalFilePaths;
+        textureFilePaths(textureReferences, colorFilePaths, normalFilePaths);
+        auto colorTextures = TextureCache::instance().textures<TextureType::TrueColor>(colorFilePaths);
+        auto normalTextures = TextureCache::instance().textures<TextureType::NormalMap>(normalFilePaths);
+        assignTextures(textureReferences, colorFilePaths, colorTextures, normalFilePaths, normalTextures);
+    }
 
-            if (l[0] == "vt") {
-                float x = l[1].toFloat();
-                while (x < 0.0f) {
-                    x += 1.0f;
-                }
-                while (x > 1.0f) {
-                    x -= 1.0f;
-                }
-                float y = l[2].toFloat();
-                while (y < 0.0f) {
-                    y += 1.0f;
-                }
-                while (y > 1.0f) {
-                    y -= 1.0f;
-                }
-                texcoords.push_back(Point2f(x, y));
-                continue;
-            }
+    static void loadPlaceholderTextures(TextureReferences const& textureReferences) {
+        PHOTON_MAPPING_TRACE_SCOPE("load placeholder textures");
+        static int const MAX_PLACEHOLDER_SIZE = 64;
+        Extent2i maxExtent(MAX_PLACEHOLDER_SIZE, MAX_PLACEHOLDER_SIZE);
+        QStringList colorFilePaths;
+        QStringList normalFilePaths;
+        textureFilePaths(textureReferences, colorFilePaths, normalFilePaths);
+        auto colorTextures = TextureCache::instance().placeholders<TextureType::TrueColor>(colorFilePaths, maxExtent);
+        auto normalTextures = TextureCache::instance().placeholders<TextureType::NormalMap>(normalFilePaths, maxExtent);
+        assignTextures(textureReferences, colorFilePaths, colorTextures, normalFilePaths, normalTextures);
+    }
 
-            if (l[0] == "f") {
-                if (!currentObjectFaces) {
-                    currentObjectFaces = &objects[""];
-                }
-                switch (l.length() - 1) {
-                    case 4: {
-                        Face face;
-                        for (int i = 0; i < 3; ++i) {
-                            int j = (2 + i) % 4;
-                            QStringList fi = (l[1 + j] + "//").split("/");
-                            face.vertices[i] = fi[0].toInt();
-                            if (face.vertices[i] < 0) {
-                                face.vertices[i] += vertices.size() + 1;
-                            }
-                            face.texcoords[i] = (fi[1] == "") ? 0 : fi[1].toInt();
-                            if (face.texcoords[i] < 0) {
-                                face.texcoords[i] += texcoords.size() + 1;
-                            }
-                            face.spaces[i] = (fi[2] == "") ? 0 : fi[2].toInt();
-                            if (face.spaces[i] < 0) {
-                                face.spaces[i] += normals.size() + 1;
-                            }
-                        }
-                        face.materialIndex = currentMaterialIndex;
-                        currentObjectFaces->push_back(face);
-                    }
-                    case 3: {
-                        Face face;
-                        for (int i = 0; i < 3; ++i) {
-                            QStringList fi = (l[1 + i] + "//").split("/");
-                            face.vertices[i] = fi[0].toInt();
-                            if (face.vertices[i] < 0) {
-                                face.vertices[i] += vertices.size() + 1;
-                            }
-                            face.texcoords[i] = (fi[1] == "") ? 0 : fi[1].toInt();
-                            if (face.texcoords[i] < 0) {
-                                face.texcoords[i] += texcoords.size() + 1;
-                            }
-                            face.spaces[i] = (fi[2] == "") ? 0 : fi[2].toInt();
-                            if (face.spaces[i] < 0) {
-                                face.spaces[i] += normals.size() + 1;
-                            }
-                        }
-                        face.materialIndex = currentMaterialIndex;
-                        currentObjectFaces->push_back(face);
-                    }
-                }
-                continue;
-            }
+    static void loadTextures(TextureReferences const& textureReferences, LoadObjListener& listener) {
+        PHOTON_MAPPING_TRACE_SCOPE("load textures");
+        QStringList colorFilePaths;
+        QStringList normalFilePaths;
+        textureFilePaths(textureReferences, colorFilePaths, normalFilePaths);
+        auto colorTextures = TextureCache::instance().textures<TextureType::TrueColor>(colorFilePaths);
+        auto normalTextures = TextureCache::instance().textures<TextureType::NormalMap>(normalFilePaths);
+        listener.texturesLoaded([=]{
+            assignTextures(textureReferences, colorFilePaths, colorTextures, normalFilePaths, normalTextures);
+        });
+    }
 
-            if (l[0] == "usemtl") {
-                QString materialName = l[1];
-                auto materialIt = materials.find(materialName);
-                if (materialIt != materials.end()) {
-                    currentMaterialIndex = std::distance(materials.begin(), materialIt);
-                } else {
-                    currentMaterialIndex = -1;
+    static void buildVertices(QThreadPool& threadPool, int threadCount, ObjectBuilder& objectBuilder, std::vector<Vector3f> const& normals, std::vector<Point2f> const& texcoords, qint64 liveBytes, LoadObjStatistics& statistics) {
+        PHOTON_MAPPING_TRACE_SCOPE("build OBJ vertices");
+        int spacesBegin = normals.size() + 1;
+        int spacesEnd = 1;
+        for (auto const& triangleCorners : objectBuilder.triangleCorners) {
+            for (int j = 0; j < 3; ++j) {
+                if (triangleCorners.spaces[j] != 0) {
+                    spacesBegin = min(spacesBegin, triangleCorners.spaces[j]);
+                    spacesEnd = max(spacesEnd, triangleCorners.spaces[j] + 1);
                 }
-                continue;
             }
+        }
+        spacesEnd = max(spacesEnd, spacesBegin);
 
-            if (l[0] == "mtllib") {
-                for (int i = 1; i < l.length(); ++i) {
-                    QString mtlFilePath = QDir::cleanPath(QDir(dirPath).filePath(l[i]));
-                    loadMtl(materials, mtlFilePath);
-                }
-                continue;
-            }
+        std::vector<Vector3f> tangents(spacesEnd - spacesBegin, Vector3f::ZERO);
+        std::vector<Vector3f> bitangents(spacesEnd - spacesBegin, Vector3f::ZERO); {
+            PHOTON_MAPPING_TRACE_SCOPE("accumulate OBJ tangents");
+            accumulateTangents(threadPool, 4 * threadCount, objectBuilder, texcoords, spacesBegin, spacesEnd, tangents, bitangents);
+        }
 
-            if (l[0] == "o") {
-                currentObjectFaces = &objects[l[1]];
-                continue;
-            }
+        static int const MIN_VERTEX_RANGE_SIZE = 1 << 16;
+        std::vector<VertexRange> vertexRanges;
+        int triangleCount = objectBuilder.triangles.size();
+        int rangeCount = max(1, min(4 * threadCount, triangleCount / MIN_VERTEX_RANGE_SIZE));
+        for (int range = 0; range < rangeCount; ++range) {
+            VertexRange vertexRange;
+            vertexRange.trianglesBegin = qint64(triangleCount) * range / rangeCount;
+            vertexRange.trianglesEnd = qint64(triangleCount) * (range + 1) / rangeCount;
+            vertexRange.verticesBegin = 0;
+            vertexRanges.push_back(vertexRange);
         }
 
-        for (auto& object : objects) {
-            auto& objectFaces = object.second;
-            std::vector<Mesh::Triangle> objectTriangles(objectFaces.size()); {
-                for (int i = 0; i < objectTriangles.size(); ++i) {
-                    objectTriangles[i].vertex = vertices[objectFaces[i].vertices[0] - 1];
-                    objectTriangles[i].edge01 = vertices[objectFaces[i].vertices[1] - 1] - objectTriangles[i].vertex;
-                    objectTriangles[i].edge02 = vertices[objectFaces[i].vertices[2] - 1] - objectTriangles[i].vertex;
-                    for (int j = 0; j < 3; ++j) {
-                        if (objectFaces[i].texcoords[j] != 0) {
-                            objectTriangles[i].texcoords[j] = texcoords[objectFaces[i].texcoords[j] - 1];
-                        } else {
-                            objectTriangles[i].texcoords[j] = Point2f::ORIGIN;
-                        }
-                    }
-                    objectTriangles[i].materialIndex = objectFaces[i].materialIndex;
-                }
-                tangents.resize(normals.size(), Vector3f::ZERO);
-                bitangents.resize(normals.size(), Vector3f::ZERO);
-                for (int i = 0; i < objectFaces.size(); ++i) {
-                    Vector2f texcoordEdge01 = objectTriangles[i].texcoords[1] - objectTriangles[i].texcoords[0];
-                    Vector2f texcoordEdge02 = objectTriangles[i].texcoords[2] - objectTriangles[i].texcoords[0];
-                    float d = texcoordEdge01.x * texcoordEdge02.y - texcoordEdge01.y * texcoordEdge02.x;
-                    if (d != 0.0f) {
-                        float id = 1.0f / d;
-                        Vector3f tangent = (objectTriangles[i].edge01 * (+texcoordEdge02.y) + objectTriangles[i].edge02 * (-texcoordEdge01.y)) * id;
-                        Vector3f bitangent = (objectTriangles[i].edge01 * (-texcoordEdge02.x) + objectTriangles[i].edge02 * (+texcoordEdge01.x)) * id;
-                        for (int j = 0; j < 3; ++j) {
-                            if (objectFaces[i].spaces[j] != 0) {
-                                tangents[objectFaces[i].spaces[j] - 1] += tangent;
-                                bitangents[objectFaces[i].spaces[j] - 1] += bitangent;
-                            }
-                        }
-                    }
-                }
-                for (int i = 0; i < objectTriangles.size(); ++i) {
+        {
+            PHOTON_MAPPING_TRACE_SCOPE("build OBJ vertices");
+            parallelFor(threadPool, vertexRanges.size(), [&](int range) {
+                VertexRange& vertexRange = vertexRanges[range];
+                std::unordered_map<Mesh::Vertex, int, VertexHash, VertexEqual> vertexIndices;
+                for (int i = vertexRange.trianglesBegin; i < vertexRange.trianglesEnd; ++i) {
+                    Mesh::Triangle const& triangle = objectBuilder.triangles[i];
+                    TriangleCorners const& triangleCorners = objectBuilder.triangleCorners[i];
                     for (int j = 0; j < 3; ++j) {
+                        int space = triangleCorners.spaces[j];
                         Vector3f normal;
-                        if (objectFaces[i].spaces[j] != 0) {
-                            normal = normals[objectFaces[i].spaces[j] - 1];
+                        if (space != 0) {
+                            normal = normals[space - 1];
                         } else {
-                            normal = unit(cross(objectTriangles[i].edge01, objectTriangles[i].edge02));
+                            normal = unit(cross(triangle.edge01, triangle.edge02));
                         }
                         Vector3f tangent;
-                        if (objectFaces[i].spaces[j] != 0 && sqrLength(tangents[objectFaces[i].spaces[j] - 1]) > 0.0f) {
-                            tangent = tangents[objectFaces[i].spaces[j] - 1];
+                        if (space != 0 && sqrLength(tangents[space - spacesBegin]) > 0.0f) {
+                            tangent = tangents[space - spacesBegin];
                             tangent = unit(tangent - normal * dot(normal, tangent));
                         } else {
-                            tangent = unit(objectTriangles[i].edge01);
+                            tangent = unit(triangle.edge01);
                         }
                         Vector3f bitangent;
-                        if (objectFaces[i].spaces[j] != 0 && sqrLength(bitangents[objectFaces[i].spaces[j] - 1]) > 0.0f) {
-                            bitangent = bitangents[objectFaces[i].spaces[j] - 1];
+                        if (space != 0 && sqrLength(bitangents[space - spacesBegin]) > 0.0f) {
+                            bitangent = bitangents[space - spacesBegin];
                             bitangent = unit(bitangent - normal * dot(normal, bitangent));
                         } else {
                             bitangent = cross(normal, tangent);
                         }
-                        objectTriangles[i].tangents[j] = tangent;
-                        objectTriangles[i].bitangents[j] = bitangent;
-                        objectTriangles[i].normals[j] = normal; 
+                        Mesh::Vertex vertex(tangent, bitangent, normal, cornerTexcoord(texcoords, triangleCorners.texcoords[j]));
+                        auto vertexIndex = vertexIndices.insert(std::make_pair(vertex, int(vertexRange.vertices.size())));
+                        if (vertexIndex.second) {
+                            vertexRange.vertices.push_back(vertex);
+                        }
+                        objectBuilder.triangleAttributes[i].vertices[j] = vertexIndex.first->second;
                     }
                 }
+                vertexRange.vertexIndicesBytes = qint64(vertexIndices.size()) * (sizeof(Mesh::Vertex) + sizeof(int) + 2 * sizeof(void*));
+            });
+        }
+
+        qint64 vertexRangesBytes = 0;
+        for (auto& vertexRange : vertexRanges) {
+            vertexRange.verticesBegin = objectBuilder.vertices.size();
+            objectBuilder.vertices.resize(objectBuilder.vertices.size() + vertexRange.vertices.size());
+            vertexRangesBytes += byteSize(vertexRange.vertices) + vertexRange.vertexIndicesBytes;
+        }
+        statistics.estimatedPeakBytes = max(statistics.estimatedPeakBytes, liveBytes + byteSize(tangents) + byteSize(bitangents) + vertexRangesBytes);
+        release(tangents);
+        release(bitangents);
+
+        parallelFor(threadPool, vertexRanges.size(), [&](int range) {
+            VertexRange& vertexRange = vertexRanges[range];
+            if (vertexRange.verticesBegin != 0) {
+                for (int i = vertexRange.trianglesBegin; i < vertexRange.trianglesEnd; ++i) {
+                    for (int j = 0; j < 3; ++j) {
+                        objectBuilder.triangleAttributes[i].vertices[j] += vertexRange.verticesBegin;
+                    }
+                }
+            }
+            std::copy(vertexRange.vertices.begin(), vertexRange.vertices.end(), objectBuilder.vertices.begin() + vertexRange.verticesBegin);
+            release(vertexRange.vertices);
+        });
+
+        release(objectBuilder.triangleCorners);
+    }
+
+    static void loadObj(std::vector<std::pair<QString, std::shared_ptr<Mesh const>>>& meshes, std::map<QString, std::shared_ptr<Material>>& materials, TextureReferences& textureReferences, QStringList& mtlFilePaths, char const* begin, char const* end, QString const& dirPath, LoadObjListener* listener, LoadObjStatistics& statistics) {
+        static std::ptrdiff_t const MIN_CHUNK_SIZE = 1 << 20;
+        static std::ptrdiff_t const MAX_CHUNK_SIZE = 1 << 26;
+        int threadCount = QThread::idealThreadCount();
+        std::ptrdiff_t chunkSize = min(max(MIN_CHUNK_SIZE, (end - begin) / (4 * threadCount) + 1), MAX_CHUNK_SIZE);
+
+        std::vector<Point3f> vertices;
+        std::vector<Vector3f> normals;
+        std::vector<Point2f> texcoords;
+        int currentMaterialIndex = -1;
+        QString currentObjectName;
+        ObjectBuilder currentObject;
+        bool placeholderTexturesLoaded = false;
+        std::deque<std::unique_ptr<PendingMesh>> pendingMeshes;
+        qint64 pendingMeshesBytes = 0;
+
+        auto liveBytes = [&]() -> qint64 {
+            return byteSize(vertices) + byteSize(normals) + byteSize(texcoords)
+                + byteSize(currentObject.triangles) + byteSize(currentObject.triangleAttributes) + byteSize(currentObject.triangleCorners) + byteSize(currentObject.vertices)
+                + pendingMeshesBytes + statistics.meshBytes;
+        };
+
+        QThreadPool threadPool;
+        threadPool.setMaxThreadCount(threadCount);
+        // declared after pendingMeshes so that its destructor waits for the builds before they are freed
+        QThreadPool meshThreadPool;
+        meshThreadPool.setMaxThreadCount(threadCount);
+
+        auto deliverBuiltMeshes = [&]{
+            while (!pendingMeshes.empty() && pendingMeshes.front()->built.loadAcquire()) {
+                PendingMesh& pendingMesh = *pendingMeshes.front();
+                pendingMeshesBytes -= pendingMesh.objectBuilderBytes;
+                statistics.meshBytes += byteSize(*pendingMesh.mesh);
+                meshes.push_back(std::make_pair(pendingMesh.name, pendingMesh.mesh));
+                if (listener && !listener->isAborted()) {
+                    listener->objectLoaded(makeObject(pendingMesh.name, pendingMesh.mesh, materials));
+                }
+                pendingMeshes.pop_front();
+            }
+        };
+
+        auto finishObject = [&]{
+            if (currentObject.triangles.empty() || isAborted(listener)) {
+                return;
+            }
+            if (listener && !placeholderTexturesLoaded) {
+                loadPlaceholderTextures(textureReferences);
+                placeholderTexturesLoaded = true;
+            }
+            buildVertices(threadPool, threadCount, currentObject, normals, texcoords, liveBytes(), statistics);
+            std::unique_ptr<PendingMesh> pendingMesh(new PendingMesh());
+            pendingMesh->name = currentObjectName;
+            pendingMesh->objectBuilder.triangles.swap(currentObject.triangles);
+            pendingMesh->objectBuilder.triangleAttributes.swap(currentObject.triangleAttributes);
+            pendingMesh->objectBuilder.vertices.swap(currentObject.vertices);
+            pendingMesh->objectBuilderBytes = byteSize(pendingMesh->objectBuilder.triangles) + byteSize(pendingMesh->objectBuilder.triangleAttributes) + byteSize(pendingMesh->objectBuilder.vertices);
+            currentObject = ObjectBuilder();
+            pendingMeshesBytes += pendingMesh->objectBuilderBytes;
+            meshThreadPool.start(new MeshBuild(pendingMesh.get()));
+            pendingMeshes.push_back(std::move(pendingMesh));
+            deliverBuiltMeshes();
+        };
+
+        for (char const* batchBegin = begin; batchBegin != end;) {
+            if (isAborted(listener)) {
+                return;
+            }
+            deliverBuiltMeshes();
+            std::vector<Chunk> chunks;
+            while (batchBegin != end && int(chunks.size()) < threadCount) {
+                char const* chunkEnd = (end - batchBegin > chunkSize) ? batchBegin + chunkSize : end;
+                while (chunkEnd != end && *(chunkEnd - 1) != '\n') {
+                    ++chunkEnd;
+                }
+                Chunk chunk;
+                chunk.begin = batchBegin;
+                chunk.end = chunkEnd;
+                chunks.push_back(chunk);
+                batchBegin = chunkEnd;
             }
-            scene->addObject([&](QString const& objectName){
-                auto object = std::make_shared<Object>();
-                object->setName(objectName);
-                std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(objectTriangles.begin(), objectTriangles.end());
-                object->setMesh(mesh);
-                for (auto& material = materials.begin(); material != materials.end(); ++material) {
-                    object->setMaterial(std::distance(materials.begin(), material), material->second);
+            parallelFor(threadPool, chunks.size(), [&](int chunk) {
+                parseChunk(chunks[chunk]);
+            });
+            qint64 chunksBytes = 0;
+            for (auto const& chunk : chunks) {
+                chunksBytes += byteSize(chunk.vertices) + byteSize(chunk.normals) + byteSize(chunk.texcoords) + byteSize(chunk.faces) + byteSize(chunk.statements);
+            }
+            statistics.estimatedPeakBytes = max(statistics.estimatedPeakBytes, liveBytes() + chunksBytes);
+
+            for (auto& chunk : chunks) {
+                int vertexBase = vertices.size();
+                int texcoordBase = texcoords.size();
+                int normalBase = normals.size();
+                vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+                texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+                normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+                release(chunk.vertices);
+                release(chunk.texcoords);
+                release(chunk.normals);
+                auto statement = chunk.statements.begin();
+                for (int faceIndex = 0; faceIndex <= int(chunk.faces.size()); ++faceIndex) {
+                    for (; statement != chunk.statements.end() && statement->faceIndex == faceIndex; ++statement) {
+                        QStringList const& l = statement->tokens;
+
+                        if (l[0] == "usemtl") {
+                            QString materialName = l.value(1);
+                            auto materialIt = materials.find(materialName);
+                            if (materialIt != materials.end()) {
+                                currentMaterialIndex = std::distance(materials.begin(), materialIt);
+                            } else {
+                                currentMaterialIndex = -1;
+                            }
+                            continue;
+                        }
+
+                        if (l[0] == "mtllib") {
+                            for (int i = 1; i < l.length(); ++i) {
+                                QString mtlFilePath = QDir::cleanPath(QDir(dirPath).filePath(l[i]));
+                                loadMtl(materials, textureReferences, mtlFilePath);
+                                mtlFilePaths.append(mtlFilePath);
+                            }
+                            continue;
+                        }
+
+                        if (l[0] == "o") {
+                            finishObject();
+                            currentObjectName = l.value(1);
+                            continue;
+                        }
+                    }
+                    if (faceIndex == int(chunk.faces.size())) {
+                        break;
+                    }
+                    ChunkFace const& chunkFace = chunk.faces[faceIndex];
+                    Mesh::Triangle triangle;
+                    Mesh::TriangleAttributes triangleAttributes;
+                    TriangleCorners triangleCorners;
+                    Point3f triangleVertices[3];
+                    for (int i = 0; i < 3; ++i) {
+                        int vertex = chunkFace.vertices[i] + ((chunkFace.relativeMask & (1 << (3 * i + 0))) ? vertexBase : 0);
+                        triangleVertices[i] = vertices[vertex - 1];
+                        triangleCorners.texcoords[i] = chunkFace.texcoords[i] + ((chunkFace.relativeMask & (1 << (3 * i + 1))) ? texcoordBase : 0);
+                        triangleCorners.spaces[i] = chunkFace.spaces[i] + ((chunkFace.relativeMask & (1 << (3 * i + 2))) ? normalBase : 0);
+                    }
+                    triangle.vertex = triangleVertices[0];
+                    triangle.edge01 = triangleVertices[1] - triangle.vertex;
+                    triangle.edge02 = triangleVertices[2] - triangle.vertex;
+                    triangleAttributes.materialIndex = currentMaterialIndex;
+                    currentObject.triangles.push_back(triangle);
+                    currentObject.triangleAttributes.push_back(triangleAttributes);
+                    currentObject.triangleCorners.push_back(triangleCorners);
                 }
-                return object;
-            }(object.first));
+                release(chunk.faces);
+                release(chunk.statements);
+            }
+            statistics.estimatedPeakBytes = max(statistics.estimatedPeakBytes, liveBytes());
         }
+        finishObject();
+        {
+            PHOTON_MAPPING_TRACE_SCOPE("wait for OBJ meshes");
+            meshThreadPool.waitForDone();
+        }
+        deliverBuiltMeshes();
+        statistics.estimatedPeakBytes = max(statistics.estimatedPeakBytes, statistics.meshBytes);
     }
 
-    void loadObj(std::shared_ptr<Scene> const& scene, QString const& objFilePath) {
+    static bool loadObj(std::vector<std::pair<QString, std::shared_ptr<Mesh const>>>& meshes, std::map<QString, std::shared_ptr<Material>>& materials, TextureReferences& textureReferences, QStringList& mtlFilePaths, QString const& objFilePath, LoadObjListener* listener, LoadObjStatistics& statistics) {
         QFile file(objFilePath);
-        if (file.open(QFile::ReadOnly | QFile::Text)) {
-            QTextStream textStream(&file);
-            loadObj(scene, textStream, QDir(objFilePath).filePath("../"));
+        if (!file.open(QFile::ReadOnly)) {
+            return false;
+        }
+        QString dirPath = QDir(objFilePath).filePath("../");
+        if (uchar* data = file.map(0, file.size())) {
+            char const* begin = reinterpret_cast<char const*>(data);
+            loadObj(meshes, materials, textureReferences, mtlFilePaths, begin, begin + file.size(), dirPath, listener, statistics);
+            file.unmap(data);
+        } else {
+            QByteArray contents = file.readAll();
+            loadObj(meshes, materials, textureReferences, mtlFilePaths, contents.constData(), contents.constData() + contents.size(), dirPath, listener, statistics);
+        }
+        return true;
+    }
+
+    LoadObjStatistics::LoadObjStatistics()
+        : estimatedPeakBytes(0)
+        , meshBytes(0)
+        , cached(false)
+    {}
+
+    static void loadObj(std::vector<std::pair<QString, std::shared_ptr<Mesh const>>>& meshes, std::map<QString, std::shared_ptr<Material>>& materials, QString const& objFilePath, LoadObjListener* listener, LoadObjStatistics* statistics) {
+        PHOTON_MAPPING_TRACE_SCOPE("load OBJ");
+        LoadObjStatistics loadStatistics;
+        QString cacheFilePath = objFilePath + ".cache";
+        TextureReferences textureReferences;
+        QStringList dependencyFilePaths;
+        if (loadSceneCache(cacheFilePath, dependencyFilePaths, meshes)) {
+            for (int i = 1; i < dependencyFilePaths.size(); ++i) {
+                loadMtl(materials, textureReferences, dependencyFilePaths[i]);
+            }
+            loadStatistics.cached = true;
+            for (auto const& mesh : meshes) {
+                loadStatistics.meshBytes += byteSize(*mesh.second);
+            }
+            if (listener) {
+                loadPlaceholderTextures(textureReferences);
+                for (auto const& mesh : meshes) {
+                    listener->objectLoaded(makeObject(mesh.first, mesh.second, materials));
+                }
+            }
+        } else {
+            QStringList mtlFilePaths;
+            if (!loadObj(meshes, materials, textureReferences, mtlFilePaths, objFilePath, listener, loadStatistics) || isAborted(listener)) {
+                return;
+            }
+            dependencyFilePaths.append(objFilePath);
+            for (auto const& mtlFilePath : mtlFilePaths) {
+                dependencyFilePaths.append(mtlFilePath);
+            }
+            saveSceneCache(cacheFilePath, dependencyFilePaths, meshes);
+        }
+
+        if (!listener) {
+            loadTextures(textureReferences);
+        } else if (!listener->isAborted()) {
+            loadTextures(textureReferences, *listener);
         }
+        if (statistics) {
+            *statistics = loadStatistics;
+        }
+    }
+
+    void loadObj(std::shared_ptr<Scene> const& scene, QString const& objFilePath, LoadObjStatistics* statistics) {
+        std::vector<std::pair<QString, std::shared_ptr<Mesh const>>> meshes;
+        std::map<QString, std::shared_ptr<Material>> materials;
+        loadObj(meshes, materials, objFilePath, nullptr, statistics);
+        for (auto const& mesh : meshes) {
+            scene->addObject(makeObject(mesh.first, mesh.second, materials));
+        }
+    }
+
+    void loadObj(LoadObjListener& listener, QString const& objFilePath, LoadObjStatistics* statistics) {
+        std::vector<std::pair<QString, std::shared_ptr<Mesh const>>> meshes;
+        std::map<QString, std::shared_ptr<Material>> materials;
+        loadObj(meshes, materials, objFilePath, &listener, statistics);
     }
 }
\ No newline at end of file
@@ -2,13 +2,33 @@
 #define PHOTON_MAPPING_LOAD_OBJ_HPP
 
 #include <memory>
+#include <functional>
 
 #include <QString>
 
 #include "Scene.hpp"
 
 namespace photon_mapping {
-    void loadObj(std::shared_ptr<Scene> const& scene, QString const& objFilePath);
+    struct LoadObjStatistics {
+        qint64 estimatedPeakBytes;
+        qint64 meshBytes;
+        bool cached;
+
+        LoadObjStatistics();
+    };
+
+    class LoadObjListener {
+        public:
+            virtual bool isAborted() const = 0;
+            virtual void objectLoaded(std::shared_ptr<Object> const& object) = 0;
+            virtual void texturesLoaded(std::function<void()> const& assignTextures) = 0;
+
+        protected:
+            ~LoadObjListener() {}
+    };
+
+    void loadObj(std::shared_ptr<Scene> const& scene, QString const& objFilePath, LoadObjStatistics* statistics = nullptr);
+    void loadObj(LoadObjListener& listener, QString const& objFilePath, LoadObjStatistics* statistics = nullptr);
 }
 
 #endif
\ No newline at end of file
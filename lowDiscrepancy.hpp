@@ -0,0 +1,36 @@
+#ifndef PHOTON_MAPPING_LOW_DISCREPANCY_HPP
+#define PHOTON_MAPPING_LOW_DISCREPANCY_HPP
+
+#include <cstdint>
+
+#include "Point.hpp"
+
+namespace photon_mapping {
+    inline std::uint32_t radicalInverse2(std::uint32_t index) {
+        index = (index << 16) | (index >> 16);
+        index = ((index & 0x00FF00FF) << 8) | ((index & 0xFF00FF00) >> 8);
+        index = ((index & 0x0F0F0F0F) << 4) | ((index & 0xF0F0F0F0) >> 4);
+        index = ((index & 0x33333333) << 2) | ((index & 0xCCCCCCCC) >> 2);
+        index = ((index & 0x55555555) << 1) | ((index & 0xAAAAAAAA) >> 1);
+        return index;
+    }
+
+    inline std::uint32_t sobolSecondDimension(std::uint32_t index) {
+        std::uint32_t result = 0;
+        for (std::uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+            if (index & 1) {
+                result ^= v;
+            }
+        }
+        return result;
+    }
+
+    inline Point2f sobol2(std::uint32_t index, std::uint32_t scramble = 0) {
+        return Point2f(
+            ((radicalInverse2(index) ^ scramble) >> 8) * (1.0f / 16777216.0f),
+            ((sobolSecondDimension(index) ^ scramble) >> 8) * (1.0f / 16777216.0f)
+        );
+    }
+}
+
+#endif
@@ -0,0 +1,6 @@
+#include "MicrobenchmarkApplication.hpp"
+
+int main(int argc, char *argv[]) {
+    using namespace photon_mapping;
+    return MicrobenchmarkApplication(argc, argv).run();
+}
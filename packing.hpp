@@ -0,0 +1,162 @@
+#ifndef PHOTON_MAPPING_PACKING_HPP
+#define PHOTON_MAPPING_PACKING_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "mathFunctions.hpp"
+#include "Vector.hpp"
+#include "Color.hpp"
+
+namespace photon_mapping {
+    inline std::uint16_t packHalf(float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::uint32_t sign = (bits >> 16) & 0x8000;
+        std::uint32_t biasedExponent = (bits >> 23) & 0xff;
+        std::uint32_t mantissa = bits & 0x7fffff;
+        if (biasedExponent == 0xff) {
+            return std::uint16_t(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+        }
+        int exponent = int(biasedExponent) - 127 + 15;
+        if (exponent >= 31) {
+            return std::uint16_t(sign | 0x7c00);
+        }
+        int shift = 13;
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return std::uint16_t(sign);
+            }
+            mantissa |= 0x800000;
+            shift = 14 - exponent;
+            exponent = 0;
+        }
+        std::uint32_t half = (std::uint32_t(exponent) << 10) + (mantissa >> shift);
+        std::uint32_t rest = mantissa & ((1u << shift) - 1);
+        std::uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) {
+            ++half;
+        }
+        return std::uint16_t(sign | half);
+    }
+
+    inline float unpackHalf(std::uint16_t half) {
+        std::uint32_t sign = std::uint32_t(half & 0x8000) << 16;
+        std::uint32_t exponent = (half >> 10) & 0x1f;
+        std::uint32_t mantissa = half & 0x3ff;
+        std::uint32_t bits;
+        if (exponent == 0) {
+            float value = std::ldexp(float(mantissa), -24);
+            return sign ? -value : value;
+        } else if (exponent == 31) {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        } else {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline float signNotZero(float x) {
+        return (x < 0.0f) ? -1.0f : 1.0f;
+    }
+
+    inline std::int16_t packSnorm16(float x) {
+        return std::int16_t(std::floor(clamp(-1.0f, x, 1.0f) * 32767.0f + 0.5f));
+    }
+
+    inline float unpackSnorm16(std::int16_t x) {
+        return max(-1.0f, x / 32767.0f);
+    }
+
+    inline std::int8_t packSnorm8(float x) {
+        return std::int8_t(std::floor(clamp(-1.0f, x, 1.0f) * 127.0f + 0.5f));
+    }
+
+    inline float unpackSnorm8(std::int8_t x) {
+        return max(-1.0f, x / 127.0f);
+    }
+
+    namespace internals {
+        inline void projectOctahedral(Vector3f const& v, float& u, float& w) {
+            float l1 = abs(v.x) + abs(v.y) + abs(v.z);
+            if (!(l1 > 0.0f)) {
+                u = 0.0f;
+                w = 0.0f;
+                return;
+            }
+            u = v.x / l1;
+            w = v.y / l1;
+            if (v.z < 0.0f) {
+                float foldedU = (1.0f - abs(w)) * signNotZero(u);
+                float foldedW = (1.0f - abs(u)) * signNotZero(w);
+                u = foldedU;
+                w = foldedW;
+            }
+        }
+
+        inline Vector3f unprojectOctahedral(float u, float w) {
+            Vector3f v(u, w, 1.0f - (abs(u) + abs(w)));
+            if (v.z < 0.0f) {
+                v.x = (1.0f - abs(w)) * signNotZero(u);
+                v.y = (1.0f - abs(u)) * signNotZero(w);
+            }
+            return unit(v);
+        }
+    }
+
+    inline std::uint32_t packOctahedral(Vector3f const& v) {
+        float u, w;
+        internals::projectOctahedral(v, u, w);
+        return std::uint32_t(std::uint16_t(packSnorm16(u))) | (std::uint32_t(std::uint16_t(packSnorm16(w))) << 16);
+    }
+
+    inline Vector3f unpackOctahedral(std::uint32_t packed) {
+        float u = unpackSnorm16(std::int16_t(std::uint16_t(packed & 0xffff)));
+        float w = unpackSnorm16(std::int16_t(std::uint16_t(packed >> 16)));
+        return internals::unprojectOctahedral(u, w);
+    }
+
+    inline std::uint16_t packOctahedral16(Vector3f const& v) {
+        float u, w;
+        internals::projectOctahedral(v, u, w);
+        return std::uint16_t(std::uint8_t(packSnorm8(u)) | (std::uint8_t(packSnorm8(w)) << 8));
+    }
+
+    inline Vector3f unpackOctahedral16(std::uint16_t packed) {
+        float u = unpackSnorm8(std::int8_t(std::uint8_t(packed & 0xff)));
+        float w = unpackSnorm8(std::int8_t(std::uint8_t(packed >> 8)));
+        return internals::unprojectOctahedral(u, w);
+    }
+
+    inline std::uint32_t packRgbe(Color const& color) {
+        float maxComponent = max(color.r, max(color.g, color.b));
+        if (!(maxComponent > 1e-32f)) {
+            return 0;
+        }
+        int exponent;
+        float scale = std::frexp(maxComponent, &exponent) * 256.0f / maxComponent;
+        std::uint32_t r = std::uint32_t(min(255.0f, max(0.0f, color.r * scale)));
+        std::uint32_t g = std::uint32_t(min(255.0f, max(0.0f, color.g * scale)));
+        std::uint32_t b = std::uint32_t(min(255.0f, max(0.0f, color.b * scale)));
+        std::uint32_t e = std::uint32_t(clamp(0, exponent + 128, 255));
+        return r | (g << 8) | (b << 16) | (e << 24);
+    }
+
+    inline Color unpackRgbe(std::uint32_t packed) {
+        std::uint32_t e = packed >> 24;
+        if (e == 0) {
+            return Color::BLACK;
+        }
+        float scale = std::ldexp(1.0f, int(e) - (128 + 8));
+        return Color(
+            ((packed & 0xff) + 0.5f) * scale,
+            (((packed >> 8) & 0xff) + 0.5f) * scale,
+            (((packed >> 16) & 0xff) + 0.5f) * scale
+        );
+    }
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PHOTON_MAPPING_PARALLEL_FOR_HPP
+#define PHOTON_MAPPING_PARALLEL_FOR_HPP
+
+#include <memory>
+#include <vector>
+
+#include <QThreadPool>
+#include <QRunnable>
+
+namespace photon_mapping {
+    namespace internals {
+        template <typename Function>
+        class IndexedRunnable
+            : public QRunnable
+        {
+            public:
+                IndexedRunnable(Function const& function, int index)
+                    : m_function(function)
+                    , m_index(index)
+                {
+                    setAutoDelete(false);
+                }
+
+                virtual void run() {
+                    m_function(m_index);
+                }
+
+            private:
+                Function m_function;
+                int m_index;
+        };
+    }
+
+    template <typename Function>
+    void parallelFor(QThreadPool& threadPool, int count, Function const& function) {
+        std::vector<std::unique_ptr<internals::IndexedRunnable<Function>>> runnables;
+        for (int i = 0; i < count; ++i) {
+            runnables.push_back(std::unique_ptr<internals::IndexedRunnable<Function>>(new internals::IndexedRunnable<Function>(function, i)));
+            threadPool.start(runnables.back().get());
+        }
+        threadPool.waitForDone();
+    }
+}
+
+#endif
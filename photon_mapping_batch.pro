@@ -0,0 +1,82 @@
+TEMPLATE = app
+TARGET = photon_mapping_batch
+
+QT = core gui
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DEFINES += PHOTON_MAPPING_COUNTERS
+}
+
+SOURCES += \
+    BatchApplication.cpp \
+    batchMain.cpp \
+    Color.cpp \
+    Counters.cpp \
+    IrradianceCache.cpp \
+    loadObj.cpp \
+    Material.cpp \
+    Mesh.cpp \
+    Object.cpp \
+    Renderer.cpp \
+    RendererBase.cpp \
+    Scene.cpp \
+    sceneCache.cpp \
+    Surface.cpp \
+    TextureCache.cpp \
+    Trace.cpp \
+    WorkerSet.cpp
+
+HEADERS += \
+    Array.hpp \
+    BatchApplication.hpp \
+    BoundingIntervalHierarchy.hpp \
+    Camera.hpp \
+    Color.hpp \
+    Counters.hpp \
+    Extent.hpp \
+    IrradianceCache.hpp \
+    loadObj.hpp \
+    lowDiscrepancy.hpp \
+    Material.hpp \
+    mathConstants.hpp \
+    mathFunctions.hpp \
+    Matrix.hpp \
+    Mesh.hpp \
+    Object.hpp \
+    packing.hpp \
+    parallelFor.hpp \
+    Photon.hpp \
+    PhotonMap.hpp \
+    Point.hpp \
+    Random.hpp \
+    Ray.hpp \
+    Renderer.hpp \
+    RendererBase.hpp \
+    Scene.hpp \
+    sceneCache.hpp \
+    Segment.hpp \
+    Surface.hpp \
+    Texture.hpp \
+    TextureCache.hpp \
+    Trace.hpp \
+    Vector.hpp \
+    WorkerSet.hpp
+
+OTHER_FILES += \
+    BoundingIntervalHierarchy.inl \
+    Counters.inl \
+    IrradianceCache.inl \
+    Material.inl \
+    Mesh.inl \
+    Object.inl \
+    Photon.inl \
+    Renderer.inl \
+    RendererBase.inl \
+    Scene.inl \
+    Surface.inl \
+    Texture.inl \
+    TextureCache.inl \
+    Trace.inl \
+    WorkerSet.inl
@@ -0,0 +1,280 @@
+#include "sceneCache.hpp"
+
+#include <cstring>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "Trace.hpp"
+
+namespace photon_mapping {
+    namespace {
+        quint32 const MAGIC = 0x43534d50;
+        quint32 const VERSION = 3;
+        qint64 const ALIGNMENT = 16;
+
+        struct Header {
+            quint32 magic;
+            quint32 version;
+            quint32 triangleSize;
+            quint32 triangleAttributesSize;
+            quint32 vertexSize;
+            quint32 nodeSize;
+            quint32 indexSize;
+            qint64 dataOffset;
+            qint64 dataSize;
+        };
+
+        struct MeshRecord {
+            QString name;
+            qint32 triangleCount;
+            qint32 vertexCount;
+            qint32 nodeCount;
+            float area;
+            Segment3f bound;
+            qint64 trianglesOffset;
+            qint64 triangleAttributesOffset;
+            qint64 verticesOffset;
+            qint64 inclusiveCumulativeTriangleProbabilitiesOffset;
+            qint64 nodesOffset;
+            qint64 primitiveIndicesOffset;
+        };
+
+        qint64 align(qint64 offset) {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        Header expectedHeader() {
+            Header header;
+            std::memset(&header, 0, sizeof(header));
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.triangleSize = sizeof(Mesh::Triangle);
+            header.triangleAttributesSize = sizeof(Mesh::TriangleAttributes);
+            header.vertexSize = sizeof(Mesh::Vertex);
+            header.nodeSize = sizeof(Mesh::TriangleBoundingIntervalHierarchy::Node);
+            return header;
+        }
+
+        QDataStream& operator<<(QDataStream& stream, Segment3f const& segment) {
+            return stream << segment.min.x << segment.min.y << segment.min.z << segment.max.x << segment.max.y << segment.max.z;
+        }
+
+        QDataStream& operator>>(QDataStream& stream, Segment3f& segment) {
+            return stream >> segment.min.x >> segment.min.y >> segment.min.z >> segment.max.x >> segment.max.y >> segment.max.z;
+        }
+
+        QDataStream& operator<<(QDataStream& stream, MeshRecord const& record) {
+            return stream << record.name << record.triangleCount << record.vertexCount << record.nodeCount << record.area << record.bound
+                << record.trianglesOffset << record.triangleAttributesOffset << record.verticesOffset << record.inclusiveCumulativeTriangleProbabilitiesOffset
+                << record.nodesOffset << record.primitiveIndicesOffset;
+        }
+
+        QDataStream& operator>>(QDataStream& stream, MeshRecord& record) {
+            return stream >> record.name >> record.triangleCount >> record.vertexCount >> record.nodeCount >> record.area >> record.bound
+                >> record.trianglesOffset >> record.triangleAttributesOffset >> record.verticesOffset >> record.inclusiveCumulativeTriangleProbabilitiesOffset
+                >> record.nodesOffset >> record.primitiveIndicesOffset;
+        }
+
+        bool isValidArray(qint64 offset, qint64 count, qint64 elementSize, qint64 dataSize) {
+            return (offset % ALIGNMENT == 0) && (0 <= offset) && (0 <= count) && (offset + count * elementSize <= dataSize);
+        }
+
+        bool isValidMesh(MeshRecord const& record, uchar const* meshData) {
+            auto triangleAttributes = reinterpret_cast<Mesh::TriangleAttributes const*>(meshData + record.triangleAttributesOffset);
+            for (int triangle = 0; triangle < record.triangleCount; ++triangle) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    int vertex = triangleAttributes[triangle].vertices[corner];
+                    if (vertex < 0 || record.vertexCount <= vertex) {
+                        return false;
+                    }
+                }
+            }
+            auto nodes = reinterpret_cast<Mesh::TriangleBoundingIntervalHierarchy::Node const*>(meshData + record.nodesOffset);
+            for (int node = 0; node < record.nodeCount; ++node) {
+                Mesh::TriangleBoundingIntervalHierarchy::Node const& n = nodes[node];
+                if (n.axis == -1) {
+                    if (n.primitiveIndicesBegin < 0 || n.primitiveIndicesEnd < n.primitiveIndicesBegin || record.triangleCount < n.primitiveIndicesEnd) {
+                        return false;
+                    }
+                } else if (n.axis < 0 || 3 <= n.axis
+                    || (n.below != -1 && (n.below <= node || record.nodeCount <= n.below))
+                    || (n.above != -1 && (n.above <= node || record.nodeCount <= n.above))) {
+                    return false;
+                }
+            }
+            auto primitiveIndices = reinterpret_cast<int const*>(meshData + record.primitiveIndicesOffset);
+            for (int i = 0; i < record.triangleCount; ++i) {
+                if (primitiveIndices[i] < 0 || record.triangleCount <= primitiveIndices[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool writeArray(QSaveFile& file, qint64& offset, void const* data, qint64 size) {
+            qint64 padding = align(offset) - offset;
+            if (padding != 0 && file.write(QByteArray(padding, '\0')) != padding) {
+                return false;
+            }
+            offset += padding + size;
+            return size == 0 || file.write(static_cast<char const*>(data), size) == size;
+        }
+    }
+
+    bool loadSceneCache(QString const& cacheFilePath, QStringList& dependencyFilePaths, std::vector<std::pair<QString, std::shared_ptr<Mesh const>>>& meshes) {
+        PHOTON_MAPPING_TRACE_SCOPE("load scene cache");
+        auto file = std::make_shared<QFile>(cacheFilePath);
+        if (!file->open(QFile::ReadOnly) || file->size() < qint64(sizeof(Header))) {
+            return false;
+        }
+        uchar const* data = file->map(0, file->size());
+        if (!data) {
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, data, sizeof(header));
+        Header expected = expectedHeader();
+        if (header.magic != expected.magic || header.version != expected.version
+            || header.triangleSize != expected.triangleSize || header.triangleAttributesSize != expected.triangleAttributesSize || header.vertexSize != expected.vertexSize || header.nodeSize != expected.nodeSize
+            || qint64(sizeof(Header)) + header.indexSize > header.dataOffset || header.dataOffset % ALIGNMENT != 0 || header.dataOffset + header.dataSize != file->size()) {
+            return false;
+        }
+
+        QDataStream index(QByteArray::fromRawData(reinterpret_cast<char const*>(data + sizeof(Header)), header.indexSize));
+        index.setVersion(QDataStream::Qt_5_1);
+        index.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        QDir cacheDir = QFileInfo(cacheFilePath).absoluteDir();
+        qint32 dependencyCount;
+        index >> dependencyCount;
+        QStringList cachedDependencyFilePaths;
+        for (int i = 0; i < dependencyCount && index.status() == QDataStream::Ok; ++i) {
+            QString dependencyFilePath; qint64 size; qint64 lastModified;
+            index >> dependencyFilePath >> size >> lastModified;
+            dependencyFilePath = QDir::cleanPath(cacheDir.filePath(dependencyFilePath));
+            QFileInfo dependency(dependencyFilePath);
+            if (!dependency.exists() || dependency.size() != size || dependency.lastModified().toMSecsSinceEpoch() != lastModified) {
+                return false;
+            }
+            cachedDependencyFilePaths.append(dependencyFilePath);
+        }
+
+        qint32 meshCount;
+        index >> meshCount;
+        std::vector<MeshRecord> records;
+        for (int i = 0; i < meshCount && index.status() == QDataStream::Ok; ++i) {
+            MeshRecord record;
+            index >> record;
+            records.push_back(record);
+        }
+        if (index.status() != QDataStream::Ok) {
+            return false;
+        }
+
+        uchar const* meshData = data + header.dataOffset;
+        std::vector<std::pair<QString, std::shared_ptr<Mesh const>>> cachedMeshes;
+        for (auto const& record : records) {
+            if (!isValidArray(record.trianglesOffset, record.triangleCount, sizeof(Mesh::Triangle), header.dataSize)
+                || !isValidArray(record.triangleAttributesOffset, record.triangleCount, sizeof(Mesh::TriangleAttributes), header.dataSize)
+                || !isValidArray(record.verticesOffset, record.vertexCount, sizeof(Mesh::Vertex), header.dataSize)
+                || !isValidArray(record.inclusiveCumulativeTriangleProbabilitiesOffset, record.triangleCount, sizeof(float), header.dataSize)
+                || !isValidArray(record.nodesOffset, record.nodeCount, sizeof(Mesh::TriangleBoundingIntervalHierarchy::Node), header.dataSize)
+                || !isValidArray(record.primitiveIndicesOffset, record.triangleCount, sizeof(int), header.dataSize)
+                || !isValidMesh(record, meshData)) {
+                return false;
+            }
+            cachedMeshes.push_back(std::make_pair(record.name, std::make_shared<Mesh>(
+                reinterpret_cast<Mesh::Triangle const*>(meshData + record.trianglesOffset),
+                reinterpret_cast<Mesh::TriangleAttributes const*>(meshData + record.triangleAttributesOffset),
+                reinterpret_cast<float const*>(meshData + record.inclusiveCumulativeTriangleProbabilitiesOffset),
+                record.triangleCount,
+                reinterpret_cast<Mesh::Vertex const*>(meshData + record.verticesOffset), record.vertexCount,
+                record.area, record.bound,
+                reinterpret_cast<Mesh::TriangleBoundingIntervalHierarchy::Node const*>(meshData + record.nodesOffset), record.nodeCount,
+                reinterpret_cast<int const*>(meshData + record.primitiveIndicesOffset),
+                file
+            )));
+        }
+
+        dependencyFilePaths = cachedDependencyFilePaths;
+        meshes.swap(cachedMeshes);
+        return true;
+    }
+
+    bool saveSceneCache(QString const& cacheFilePath, QStringList const& dependencyFilePaths, std::vector<std::pair<QString, std::shared_ptr<Mesh const>>> const& meshes) {
+        PHOTON_MAPPING_TRACE_SCOPE("save scene cache");
+        QByteArray indexBytes;
+        QDataStream index(&indexBytes, QIODevice::WriteOnly);
+        index.setVersion(QDataStream::Qt_5_1);
+        index.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        QDir cacheDir = QFileInfo(cacheFilePath).absoluteDir();
+        index << qint32(dependencyFilePaths.size());
+        for (auto const& dependencyFilePath : dependencyFilePaths) {
+            QFileInfo dependency(dependencyFilePath);
+            if (!dependency.exists()) {
+                return false;
+            }
+            index << cacheDir.relativeFilePath(dependency.absoluteFilePath()) << dependency.size() << dependency.lastModified().toMSecsSinceEpoch();
+        }
+
+        index << qint32(meshes.size());
+        qint64 dataSize = 0;
+        for (auto const& mesh : meshes) {
+            MeshRecord record;
+            record.name = mesh.first;
+            record.triangleCount = mesh.second->triangles().size();
+            record.vertexCount = mesh.second->vertices().size();
+            record.nodeCount = mesh.second->boundingIntervalHierarchy().nodes().size();
+            record.area = mesh.second->area();
+            record.bound = mesh.second->bound();
+            record.trianglesOffset = align(dataSize);
+            dataSize = record.trianglesOffset + record.triangleCount * sizeof(Mesh::Triangle);
+            record.triangleAttributesOffset = align(dataSize);
+            dataSize = record.triangleAttributesOffset + record.triangleCount * sizeof(Mesh::TriangleAttributes);
+            record.verticesOffset = align(dataSize);
+            dataSize = record.verticesOffset + record.vertexCount * sizeof(Mesh::Vertex);
+            record.inclusiveCumulativeTriangleProbabilitiesOffset = align(dataSize);
+            dataSize = record.inclusiveCumulativeTriangleProbabilitiesOffset + record.triangleCount * sizeof(float);
+            record.nodesOffset = align(dataSize);
+            dataSize = record.nodesOffset + record.nodeCount * sizeof(Mesh::TriangleBoundingIntervalHierarchy::Node);
+            record.primitiveIndicesOffset = align(dataSize);
+            dataSize = record.primitiveIndicesOffset + record.triangleCount * sizeof(int);
+            index << record;
+        }
+
+        Header header = expectedHeader();
+        header.indexSize = indexBytes.size();
+        header.dataOffset = align(sizeof(Header) + indexBytes.size());
+        header.dataSize = dataSize;
+
+        QSaveFile file(cacheFilePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        qint64 offset = 0;
+        if (!writeArray(file, offset, &header, sizeof(header)) || !writeArray(file, offset, indexBytes.constData(), indexBytes.size()) || !writeArray(file, offset, nullptr, 0)) {
+            return false;
+        }
+        for (auto const& mesh : meshes) {
+            Mesh const& meshData = *mesh.second;
+            auto const& boundingIntervalHierarchy = meshData.boundingIntervalHierarchy();
+            if (!writeArray(file, offset, meshData.triangles().data(), meshData.triangles().size() * sizeof(Mesh::Triangle))
+                || !writeArray(file, offset, meshData.triangleAttributes().data(), meshData.triangleAttributes().size() * sizeof(Mesh::TriangleAttributes))
+                || !writeArray(file, offset, meshData.vertices().data(), meshData.vertices().size() * sizeof(Mesh::Vertex))
+                || !writeArray(file, offset, meshData.inclusiveCumulativeTriangleProbabilities().data(), meshData.inclusiveCumulativeTriangleProbabilities().size() * sizeof(float))
+                || !writeArray(file, offset, boundingIntervalHierarchy.nodes().data(), boundingIntervalHierarchy.nodes().size() * sizeof(Mesh::TriangleBoundingIntervalHierarchy::Node))
+                || !writeArray(file, offset, boundingIntervalHierarchy.primitiveIndices().data(), boundingIntervalHierarchy.primitiveIndices().size() * sizeof(int))) {
+                return false;
+            }
+        }
+        return file.commit();
+    }
+}
\ No newline at end of file
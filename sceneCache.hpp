@@ -0,0 +1,18 @@
+#ifndef PHOTON_MAPPING_SCENE_CACHE_HPP
+#define PHOTON_MAPPING_SCENE_CACHE_HPP
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "Mesh.hpp"
+
+namespace photon_mapping {
+    bool loadSceneCache(QString const& cacheFilePath, QStringList& dependencyFilePaths, std::vector<std::pair<QString, std::shared_ptr<Mesh const>>>& meshes);
+    bool saveSceneCache(QString const& cacheFilePath, QStringList const& dependencyFilePaths, std::vector<std::pair<QString, std::shared_ptr<Mesh const>>> const& meshes);
+}
+
+#endif
\ No newline at end of file